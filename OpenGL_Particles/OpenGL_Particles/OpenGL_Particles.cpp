@@ -4,10 +4,12 @@
 
 #include <GL/gl.h>
 #include "debug/GL_Debug.h"
+#include <cstring>
 #include <memory>
 #include <windows.h>
 
 #include "Config.h"
+#include "systems/FrameBudgetGovernor.h"
 #include "systems/ParticleSystem.h"
 
 //Target NVIDIA cards
@@ -22,37 +24,166 @@ namespace
     float aspectRatio = static_cast<float>(WINDOW_WIDTH) / static_cast<float>(WINDOW_HEIGHT);
     float fov = 45.0f;
     
-    std::unique_ptr<particle_simulation::ParticleSimulation> fireParticleSimulation = nullptr;
+    // Fire and smoke share one particle pool: one dispatch and one draw per frame
+    std::unique_ptr<particle_simulation::ParticleSimulation> particleSimulation = nullptr;
 
-    std::unique_ptr<particle_simulation::ParticleSimulation> smokeParticleSimulation = nullptr;
+    // Updates and draws the particles, thinning them out when they take more than 2 ms of GPU time
+    std::unique_ptr<particle_simulation::FrameBudgetGovernor> frameBudget = nullptr;
     
-    void initScene()
+    // recordPath or replayPath, when set, log or feed back the scene's inputs
+    void initScene(const char* recordPath, const char* replayPath)
     {
-        //Initialize the particle system and call the init method on it
-        fireParticleSimulation = std::make_unique<particle_simulation::ParticleSimulation>(
-            2000,
-            glm::vec3(0.0f, -1.0f, 0.0f),
-            25,
-            glm::ivec2(5, 5),
-            60.0,
-            5.0, 0.5, "fireSheet5x5_alpha.png");
-        
-        fireParticleSimulation->init();
+        particleSimulation = std::make_unique<particle_simulation::ParticleSimulation>(2500);
+        if (recordPath)
+        {
+            particleSimulation->startRecording(recordPath);
+        }
+        else if (replayPath)
+        {
+            particleSimulation->startReplay(replayPath);
+        }
+
+        //Fire emitter, swaying along the x-axis
+        particle_simulation::EmitterSettings fire;
+        fire.location = glm::vec3(0.0f, -1.0f, 0.0f);
+        fire.path = particle_simulation::makeSwayPath(glm::vec3(3.0f, 0.0f, 0.0f), 0.5f);
+        fire.sphereRadius = 0.5f;
+        fire.maxParticleLifetime = 5.0f;
+        fire.texturePath = "fireSheet5x5_alpha.png";
+        fire.gridSize = glm::ivec2(5, 5);
+        fire.emission.spawnRate = 800.0f;
+        particleSimulation->addEmitter(fire);
+
+        //Smoke emitter following the same path
+        particle_simulation::EmitterSettings smoke = fire;
+        smoke.sphereRadius = 1.0f;
+        smoke.maxParticleLifetime = 4.0f;
+        smoke.texturePath = "smoke_sheet.png";
+        smoke.emission.spawnRate = 250.0f;
+        particleSimulation->addEmitter(smoke);
 
-        smokeParticleSimulation = std::make_unique<particle_simulation::ParticleSimulation>(
-            500,
-            glm::vec3(0.0f, -1.0f, 0.0f),
-            25,
-            glm::ivec2(5, 5),
-            30.0,
-            4.0, 1.0, "smoke_sheet.png");
+        // Sideways breeze and the drag that slows particles as they rise
+        particleSimulation->addForce(particle_simulation::makeWindForce(glm::vec3(1.0f, 0.0f, 0.0f), 0.05f));
+        particleSimulation->addForce(particle_simulation::makeDragForce(glm::vec3(0.0f, 1.0f, 0.0f), 0.1f));
 
-        smokeParticleSimulation->init();
+        // Ground plane just under the emitters
+        particleSimulation->addCollider(particle_simulation::makePlaneCollider(glm::vec3(0.0f, 1.0f, 0.0f), -1.5f));
+
+        // Keep the smoke from collapsing into one blob
+        particleSimulation->enableDensityRepulsion(particle_simulation::DensitySettings());
+
+        // Stop simulating while the fire is out of view and fast-forward when it returns
+        particleSimulation->enableOffscreenSleep(particle_simulation::SleepSettings());
+
+        // Open on a fire that is already burning
+        particle_simulation::PrewarmSettings prewarm;
+        prewarm.duration = 5.0f;
+        particleSimulation->setPrewarm(prewarm);
+
+        particleSimulation->init();
+
+        frameBudget = std::make_unique<particle_simulation::FrameBudgetGovernor>();
+        frameBudget->addSystem(particleSimulation.get(), 0);
+    }
+
+    // Fills a 1M particle pool in each storage layout and times the update and render passes
+    void runLayoutBenchmark(GLFWwindow* window, const glm::mat4& view, const glm::mat4& projection)
+    {
+        constexpr int benchmarkParticles = 1 << 20;
+        constexpr int fillFrames = 360;
+        constexpr int measuredFrames = 120;
+        constexpr double frameDelta = 1.0 / 60.0;
+
+        GLuint timerQueries[2];
+        glGenQueries(2, timerQueries);
+
+        for (particle_simulation::ParticleLayout layout : { particle_simulation::ParticleLayout::AoS, particle_simulation::ParticleLayout::SoA,
+            particle_simulation::ParticleLayout::Packed })
+        {
+            particle_simulation::ParticleSimulation simulation(benchmarkParticles, layout);
+
+            // Lifetime times spawn rate exceeds the pool, so it stays full once filled
+            particle_simulation::EmitterSettings settings;
+            settings.location = glm::vec3(0.0f, 1.0f, 0.0f);
+            settings.sphereRadius = 2.0f;
+            settings.maxParticleLifetime = 6.0f;
+            settings.texturePath = "smoke_sheet.png";
+            settings.gridSize = glm::ivec2(5, 5);
+            settings.emission.spawnRate = benchmarkParticles / 4.0f;
+            simulation.addEmitter(settings);
+            simulation.init();
+
+            double updateMilliseconds = 0.0;
+            double renderMilliseconds = 0.0;
+
+            for (int frame = 0; frame < fillFrames + measuredFrames; frame++)
+            {
+                const bool bMeasured = frame >= fillFrames;
+
+                if (bMeasured) glBeginQuery(GL_TIME_ELAPSED, timerQueries[0]);
+                simulation.update(frameDelta);
+                if (bMeasured) glEndQuery(GL_TIME_ELAPSED);
+
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+                if (bMeasured) glBeginQuery(GL_TIME_ELAPSED, timerQueries[1]);
+                particle_simulation::ParticleSimulation::beginBlend();
+                simulation.render(view, projection);
+                particle_simulation::ParticleSimulation::endBlend();
+                if (bMeasured) glEndQuery(GL_TIME_ELAPSED);
+
+                glfwSwapBuffers(window);
+                glfwPollEvents();
+
+                if (bMeasured)
+                {
+                    GLuint64 updateNanoseconds = 0;
+                    GLuint64 renderNanoseconds = 0;
+                    glGetQueryObjectui64v(timerQueries[0], GL_QUERY_RESULT, &updateNanoseconds);
+                    glGetQueryObjectui64v(timerQueries[1], GL_QUERY_RESULT, &renderNanoseconds);
+                    updateMilliseconds += updateNanoseconds * 1.0e-6;
+                    renderMilliseconds += renderNanoseconds * 1.0e-6;
+                }
+            }
+
+            const GLuint aliveCount = simulation.readAliveCount();
+            const particle_simulation::FrameTraffic traffic = simulation.estimateFrameTraffic(aliveCount);
+
+            std::cout << particle_simulation::particleLayoutName(layout)
+                << ": " << aliveCount << " particles"
+                << ", update " << updateMilliseconds / measuredFrames << " ms (" << traffic.updateBytes / 1.0e6 << " MB)"
+                << ", render " << renderMilliseconds / measuredFrames << " ms (" << traffic.renderBytes / 1.0e6 << " MB)"
+                << std::endl;
+        }
+
+        glDeleteQueries(2, timerQueries);
     }
 }
 
-int main()
+int main(int argc, char** argv)
 {
+    // --benchmark-layouts compares the particle storage layouts instead of running the scene.
+    // --record <file> logs the scene's inputs; --replay <file> runs them again and exits.
+    bool bBenchmarkLayouts = false;
+    const char* recordPath = nullptr;
+    const char* replayPath = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--benchmark-layouts") == 0)
+        {
+            bBenchmarkLayouts = true;
+        }
+        else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            recordPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+        {
+            replayPath = argv[++i];
+        }
+    }
+
+
     // Initialize GLFW
     if (!glfwInit())
     {
@@ -96,7 +227,10 @@ int main()
     enableOpenGLDebug();
 
     //Init the scene
-    initScene();
+    if (!bBenchmarkLayouts)
+    {
+        initScene(recordPath, replayPath);
+    }
 
     double lastTime = glfwGetTime();  // Store the time at the start
     double deltaTime = 0.0;  // Time between frames
@@ -114,6 +248,16 @@ int main()
         glm::vec3(0.0f, 1.0f, 0.0f)    // Up vector
     );
     
+    if (bBenchmarkLayouts)
+    {
+        runLayoutBenchmark(window, view, projection);
+        glfwSetWindowShouldClose(window, true);
+    }
+
+    const bool bReplaying = !bBenchmarkLayouts && particleSimulation->isReplaying();
+    const double replayStartTime = glfwGetTime();
+    int replayFrames = 0;
+
     // Main loop
     while (!glfwWindowShouldClose(window))
     {
@@ -122,10 +266,7 @@ int main()
 
         lastTime = currentTime;
         
-        fireParticleSimulation->update(deltaTime);
-        smokeParticleSimulation->update(deltaTime);
-
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        frameBudget->update(deltaTime);
         
         // Render here
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -133,9 +274,8 @@ int main()
 
         particle_simulation::ParticleSimulation::beginBlend();       
         
-        // Render smoke
-        fireParticleSimulation->render(view, projection);
-        smokeParticleSimulation->render(view, projection);
+        // Render fire and smoke
+        frameBudget->render(view, projection);
 
         particle_simulation::ParticleSimulation::endBlend();
 
@@ -147,10 +287,27 @@ int main()
         // Swap buffers
         glfwSwapBuffers(window);
 
+        // Same workload every run, so the wall time compares builds and drivers
+        if (bReplaying)
+        {
+            replayFrames++;
+            if (!particleSimulation->isReplaying())
+            {
+                const double elapsed = glfwGetTime() - replayStartTime;
+                std::cout << "Replayed " << replayFrames << " frames in " << elapsed << " s ("
+                    << elapsed * 1000.0 / replayFrames << " ms per frame)" << std::endl;
+                glfwSetWindowShouldClose(window, true);
+            }
+        }
+
         // Poll for and process events
         glfwPollEvents();
     }
 
+    // GL objects go while the context is still current; the governor first, it points at the simulation
+    frameBudget.reset();
+    particleSimulation.reset();
+
     // Clean up and terminate
     glfwDestroyWindow(window);
     glfwTerminate();
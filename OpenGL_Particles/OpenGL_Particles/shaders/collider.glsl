@@ -0,0 +1,76 @@
+#ifndef COLLIDER_GLSL
+#define COLLIDER_GLSL
+
+// Shapes; mirror ColliderShape in Collider.h
+#define COLLIDER_PLANE 0u
+#define COLLIDER_SPHERE 1u
+#define COLLIDER_CAPSULE 2u
+#define COLLIDER_BOX 3u
+
+// One analytic collider; mirrors ColliderData in Collider.h (std430, 128 bytes)
+struct Collider
+{
+    vec4 center;       // plane: xyz = normal, w = offset; others: xyz = center / capsule start, w = radius
+    vec4 extent;       // capsule: xyz = segment end; box: xyz = half extents
+    vec4 axisX;        // box orientation, world-space local axes
+    vec4 axisY;
+    vec4 response;     // x = restitution, y = friction
+    uvec4 info;        // x = shape, y = kill on contact
+    vec4 boundsMin;    // world AABB for per-workgroup culling
+    vec4 boundsMax;
+};
+
+// Signed distance from position to the collider's surface (negative inside), and the outward normal there
+float colliderDistance(Collider collider, vec3 position, out vec3 normal)
+{
+    uint shape = collider.info.x;
+
+    if (shape == COLLIDER_PLANE)
+    {
+        normal = collider.center.xyz;
+        return dot(position, normal) - collider.center.w;
+    }
+
+    if (shape == COLLIDER_SPHERE || shape == COLLIDER_CAPSULE)
+    {
+        // A sphere is a capsule whose segment is a point
+        vec3 closest = collider.center.xyz;
+        if (shape == COLLIDER_CAPSULE)
+        {
+            vec3 segment = collider.extent.xyz - collider.center.xyz;
+            float t = clamp(dot(position - closest, segment) / max(dot(segment, segment), 1e-8), 0.0, 1.0);
+            closest += segment * t;
+        }
+
+        vec3 offset = position - closest;
+        float offsetLength = length(offset);
+        normal = offsetLength > 1e-6 ? offset / offsetLength : vec3(0.0, 1.0, 0.0);
+        return offsetLength - collider.center.w;
+    }
+
+    // Box, in its local frame
+    mat3 rotation = mat3(collider.axisX.xyz, collider.axisY.xyz, cross(collider.axisX.xyz, collider.axisY.xyz));
+    vec3 local = transpose(rotation) * (position - collider.center.xyz);
+    vec3 q = abs(local) - collider.extent.xyz;
+
+    vec3 localNormal;
+    float distanceToSurface;
+    if (all(lessThan(q, vec3(0.0))))
+    {
+        // Inside: leave through the nearest face
+        float axisDistance = max(q.x, max(q.y, q.z));
+        localNormal = vec3(equal(q, vec3(axisDistance))) * mix(vec3(-1.0), vec3(1.0), greaterThanEqual(local, vec3(0.0)));
+        distanceToSurface = axisDistance;
+    }
+    else
+    {
+        vec3 outside = max(q, vec3(0.0));
+        distanceToSurface = length(outside);
+        localNormal = outside * sign(local) / max(distanceToSurface, 1e-6);
+    }
+
+    normal = normalize(rotation * localNormal);
+    return distanceToSurface;
+}
+
+#endif
@@ -1,127 +1,534 @@
 #version 460 core
 
-layout(local_size_x = 512) in;
+// Variants are built with these overridden by the workgroup autotuner
+#ifndef WORK_GROUP_SIZE
+#define WORK_GROUP_SIZE 256
+#endif
 
-struct Particle
+#ifndef USE_SHARED_STAGING
+#define USE_SHARED_STAGING 0
+#endif
+
+// Set when the simulation builds a spatial grid for density repulsion
+#ifndef USE_SPATIAL_GRID
+#define USE_SPATIAL_GRID 0
+#endif
+
+// Set when the simulation draws ribbons from a per-particle position history
+#ifndef USE_TRAILS
+#define USE_TRAILS 0
+#endif
+
+layout(local_size_x = WORK_GROUP_SIZE) in;
+
+#include "emitter.glsl"
+#include "parameters.glsl"
+#include "particle_layout.glsl"
+
+// Free slots that are no longer simulated or drawn
+layout(std430, binding = 1) buffer DeadList
 {
-    vec4 position;   // xyz = position, w = size
-    vec4 color;      // rgba = color
-    vec4 velocity;   // xyz = velocity, w = lifetime
+    uint deadIndices[];
 };
 
-layout(std430, binding = 0) buffer ParticleBuffer
+// Slots to simulate this update
+layout(std430, binding = 2) readonly buffer AliveListIn
 {
-    Particle particles[];
+    uint aliveIndicesIn[];
 };
 
-uniform float deltaTime;
-uniform float sphereRadius;
-uniform float maxLifetime;
-uniform vec3 particleEmitterCurrentPos;
-uniform vec3 prevParticleEmitterPos;
-uniform bool emitterAlive;
+// Slots still alive after this update, drawn this frame and simulated next update
+layout(std430, binding = 3) writeonly buffer AliveListOut
+{
+    uint aliveIndicesOut[];
+};
 
-// Shared memory for particles within a workgroup
-shared Particle localParticles[512];
+layout(std430, binding = 4) buffer Counters
+{
+    uint aliveCount;
+    uint aliveCountAfterSimulation;
+    int deadCount;
+};
 
-void main()
+// Position before the latest tick, for render-time interpolation
+layout(std430, binding = 6) writeonly buffer PreviousPositions
 {
-    uint gid = gl_GlobalInvocationID.x;
-    uint lid = gl_LocalInvocationID.x;
+    vec4 previousPositions[];
+};
+
+layout(std430, binding = 7) readonly buffer EmitterTable
+{
+    Emitter emitters[];
+};
+
+// Emitter id of every particle slot; survivors carry theirs over to the output state set
+layout(std430, binding = 8) readonly buffer ParticleEmitters
+{
+    uint particleEmitters[];
+};
+
+layout(std430, binding = 22) writeonly buffer ParticleEmittersOut
+{
+    uint particleEmittersOut[];
+};
+
+// Baked curl-noise velocity volume; tiles, so it repeats with GL_REPEAT
+layout(binding = 0) uniform sampler3D turbulenceField;
+
+// Imported vector fields on texture units 1 to MAX_VECTOR_FIELDS
+layout(binding = 1) uniform sampler3D vectorFields[MAX_VECTOR_FIELDS];
+
+// Scene depth on texture unit 5
+layout(binding = 5) uniform sampler2D sceneDepth;
+
+#include "collider.glsl"
+
+layout(std430, binding = 13) readonly buffer ColliderTable
+{
+    Collider colliders[];
+};
+
+// Optional heightfield on texture unit 6: red channel, scaled by heightfieldScale above heightfieldOrigin.y
+layout(binding = 6) uniform sampler2D heightfield;
+
+#include "force.glsl"
+
+layout(std430, binding = 14) readonly buffer ForceTable
+{
+    Force forces[];
+};
+
+// Colliders and forces a workgroup's particles can reach this tick; culled once per workgroup
+#define MAX_GROUP_COLLIDERS 64
+#define MAX_GROUP_FORCES 32
+
+// World units a particle may travel in one tick and still be tested against a culled collider
+#define CULL_MARGIN 1.0
+
+shared uint groupBoundsMin[3];
+shared uint groupBoundsMax[3];
+shared uint groupColliderCount;
+shared uint groupColliders[MAX_GROUP_COLLIDERS];
+shared uint groupForceCount;
+shared uint groupForces[MAX_GROUP_FORCES];
+
+// Reflects the velocity into a surface: restitution scales the normal part, friction the tangential part
+void bounceParticle(inout Particle particle, vec3 normal, float restitution, float friction)
+{
+    float normalSpeed = dot(particle.velocity.xyz, normal);
+    if (normalSpeed < 0.0)
+    {
+        vec3 normalVelocity = normal * normalSpeed;
+        vec3 tangentVelocity = particle.velocity.xyz - normalVelocity;
+        particle.velocity.xyz = tangentVelocity * (1.0 - friction) - normalVelocity * restitution;
+    }
+}
+
+// World position of a depth buffer sample
+vec3 depthWorldPosition(vec2 uv, float depth)
+{
+    vec4 world = depthInverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return world.xyz / world.w;
+}
+
+vec3 depthWorldPosition(vec2 uv)
+{
+    return depthWorldPosition(uv, textureLod(sceneDepth, uv, 0.0).r);
+}
 
-    if (gid >= particles.length())
+// Bounces a particle that moved behind the visible surface back out along its normal
+void collideWithDepth(inout Particle particle)
+{
+    vec4 clip = depthViewProjection * vec4(particle.position.xyz, 1.0);
+    if (clip.w <= 0.0)
         return;
 
-    // Load particle into shared memory
-    localParticles[lid] = particles[gid];
+    vec3 ndc = clip.xyz / clip.w;
+    if (any(greaterThan(abs(ndc), vec3(1.0))))
+        return;
 
-    // Synchronize to ensure all particles are loaded
+    // One fetch decides whether the particle is in front of the scene, the common case
+    vec2 uv = ndc.xy * 0.5 + 0.5;
+    float sceneDepthValue = textureLod(sceneDepth, uv, 0.0).r;
+    if (ndc.z * 0.5 + 0.5 <= sceneDepthValue)
+        return;
+
+    // Far behind the surface means behind the object, not inside it
+    vec3 surface = depthWorldPosition(uv, sceneDepthValue);
+    if (distance(particle.position.xyz, surface) > collisionThickness)
+        return;
+
+    // Normal from the neighbouring depth samples, facing the camera
+    vec3 normal = normalize(cross(depthWorldPosition(uv + vec2(depthTexelSize.x, 0.0)) - surface,
+                                  depthWorldPosition(uv + vec2(0.0, depthTexelSize.y)) - surface));
+    if (dot(normal, depthCameraPosition - surface) < 0.0)
+    {
+        normal = -normal;
+    }
+
+    particle.position.xyz = surface + normal * 0.01;
+    bounceParticle(particle, normal, collisionRestitution, collisionFriction);
+}
+
+// Floats mapped to uints that sort the same way, for shared-memory atomicMin/atomicMax
+uint orderedFloatBits(float value)
+{
+    uint bits = floatBitsToUint(value);
+    return (bits & 0x80000000u) != 0u ? ~bits : bits | 0x80000000u;
+}
+
+float orderedBitsToFloat(uint bits)
+{
+    return uintBitsToFloat((bits & 0x80000000u) != 0u ? bits & 0x7fffffffu : ~bits);
+}
+
+// Gathers the colliders and forces whose bounds overlap the workgroup's particles into
+// groupColliders / groupForces. Contains barriers, so every invocation must call it.
+void cullWorkgroup(bool active, vec3 position)
+{
+    if (gl_LocalInvocationIndex == 0u)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            groupBoundsMin[axis] = 0xffffffffu;
+            groupBoundsMax[axis] = 0u;
+        }
+        groupColliderCount = 0u;
+        groupForceCount = 0u;
+    }
     barrier();
 
-    if(emitterAlive)
+    if (active)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            atomicMin(groupBoundsMin[axis], orderedFloatBits(position[axis]));
+            atomicMax(groupBoundsMax[axis], orderedFloatBits(position[axis]));
+        }
+    }
+    barrier();
+
+    // A group without active particles keeps min > max and matches nothing
+    if (groupBoundsMin[0] <= groupBoundsMax[0])
+    {
+        vec3 boundsMin = vec3(orderedBitsToFloat(groupBoundsMin[0]), orderedBitsToFloat(groupBoundsMin[1]), orderedBitsToFloat(groupBoundsMin[2])) - CULL_MARGIN;
+        vec3 boundsMax = vec3(orderedBitsToFloat(groupBoundsMax[0]), orderedBitsToFloat(groupBoundsMax[1]), orderedBitsToFloat(groupBoundsMax[2])) + CULL_MARGIN;
+
+        for (uint i = gl_LocalInvocationIndex; i < colliderCount; i += gl_WorkGroupSize.x)
+        {
+            if (all(lessThanEqual(colliders[i].boundsMin.xyz, boundsMax)) && all(greaterThanEqual(colliders[i].boundsMax.xyz, boundsMin)))
+            {
+                uint slot = atomicAdd(groupColliderCount, 1u);
+                if (slot < MAX_GROUP_COLLIDERS)
+                {
+                    groupColliders[slot] = i;
+                }
+            }
+        }
+
+        for (uint i = gl_LocalInvocationIndex; i < forceCount; i += gl_WorkGroupSize.x)
+        {
+            if (all(lessThanEqual(forces[i].boundsMin.xyz, boundsMax)) && all(greaterThanEqual(forces[i].boundsMax.xyz, boundsMin)))
+            {
+                uint slot = atomicAdd(groupForceCount, 1u);
+                if (slot < MAX_GROUP_FORCES)
+                {
+                    groupForces[slot] = i;
+                }
+            }
+        }
+    }
+    barrier();
+}
+
+// Applies the workgroup's forces to the particle's velocity
+void applyForces(inout Particle particle)
+{
+    // When more forces overlap than fit in shared memory, apply them all; order is kept either way
+    bool overflow = groupForceCount > MAX_GROUP_FORCES;
+    uint count = overflow ? forceCount : groupForceCount;
+
+    for (uint i = 0u; i < count; i++)
+    {
+        particle.velocity.xyz = applyForce(forces[overflow ? i : groupForces[i]], particle.position.xyz, particle.velocity.xyz, deltaTime);
+    }
+}
+
+// Resolves contacts with the workgroup's colliders and the heightfield; returns true if the particle should be killed
+bool collideWithColliders(inout Particle particle)
+{
+    // When more colliders overlap than fit in shared memory, test them all
+    bool overflow = groupColliderCount > MAX_GROUP_COLLIDERS;
+    uint count = overflow ? colliderCount : groupColliderCount;
+
+    for (uint i = 0u; i < count; i++)
+    {
+        Collider collider = colliders[overflow ? i : groupColliders[i]];
+
+        vec3 normal;
+        float distanceToSurface = colliderDistance(collider, particle.position.xyz, normal);
+        if (distanceToSurface >= 0.0)
+            continue;
+
+        if (collider.info.y != 0u)
+            return true;
+
+        particle.position.xyz -= normal * distanceToSurface;
+        bounceParticle(particle, normal, collider.response.x, collider.response.y);
+    }
+
+    if (heightfieldEnabled)
+    {
+        vec2 uv = (particle.position.xz - heightfieldOrigin.xz) / heightfieldSize;
+        if (all(greaterThanEqual(uv, vec2(0.0))) && all(lessThanEqual(uv, vec2(1.0))))
+        {
+            float height = heightfieldOrigin.y + textureLod(heightfield, uv, 0.0).r * heightfieldScale;
+            if (particle.position.y < height)
+            {
+                if (heightfieldResponse.z != 0.0)
+                    return true;
+
+                // Normal from the slope between neighbouring texels
+                vec2 texel = 1.0 / vec2(textureSize(heightfield, 0));
+                float dx = (textureLod(heightfield, uv + vec2(texel.x, 0.0), 0.0).r - textureLod(heightfield, uv - vec2(texel.x, 0.0), 0.0).r) * heightfieldScale;
+                float dz = (textureLod(heightfield, uv + vec2(0.0, texel.y), 0.0).r - textureLod(heightfield, uv - vec2(0.0, texel.y), 0.0).r) * heightfieldScale;
+                vec3 normal = normalize(vec3(-dx / (2.0 * texel.x * heightfieldSize.x), 1.0, -dz / (2.0 * texel.y * heightfieldSize.y)));
+
+                particle.position.y = height;
+                bounceParticle(particle, normal, heightfieldResponse.x, heightfieldResponse.y);
+            }
+        }
+    }
+
+    return false;
+}
+
+#if USE_SPATIAL_GRID
+#include "grid.glsl"
+
+// Pushes a particle away from close neighbours so dense smoke keeps its volume
+vec3 densityRepulsion(vec3 position, uint gid)
+{
+    vec3 push = vec3(0.0);
+    int inspected = 0;
+    ivec3 centre = gridCellCoord(position);
+
+    for (int z = -1; z <= 1; z++)
+    {
+        for (int y = -1; y <= 1; y++)
+        {
+            for (int x = -1; x <= 1; x++)
+            {
+                uvec2 cell = gridCells[gridCellHash(centre + ivec3(x, y, z))];
+
+                for (uint i = 0u; i < cell.y && inspected < densityMaxNeighbours; i++, inspected++)
+                {
+                    uvec4 neighbour = gridSortedParticles[cell.x + i];
+                    if (neighbour.w == gid)
+                        continue;
+
+                    vec3 offset = position - uintBitsToFloat(neighbour.xyz);
+                    float distanceSquared = dot(offset, offset);
+                    if (distanceSquared >= densityRadius * densityRadius || distanceSquared < 1e-12)
+                        continue;
+
+                    float distance = sqrt(distanceSquared);
+                    float falloff = 1.0 - distance / densityRadius;
+                    push += (offset / distance) * falloff * falloff;
+                }
+            }
+        }
+    }
+
+    return push * densityStrength;
+}
+#endif
+
+#if USE_TRAILS
+#include "trail.glsl"
+#endif
+
+#if USE_SHARED_STAGING
+// Shared memory for particles within a workgroup
+shared Particle localParticles[WORK_GROUP_SIZE];
+#endif
+
+// Advances one particle by deltaTime; returns false once it should go back to the dead list
+bool simulateParticle(inout Particle particle, uint gid)
+{
+    bool alive = true;
+
+    // Per-emitter parameters for this particle
+    Emitter emitter = emitters[particleEmitters[gid]];
+    float maxLifetime = emitter.previousPosition.w;
+
+    if (emitter.state.z != 0u)
     {
         // Update lifetime
-        localParticles[lid].velocity.w -= deltaTime;
+        particle.velocity.w -= deltaTime;
 
-        //TODO: Too many heavy/redundant operations. 
-        // If the particle is dead, respawn it
-        if (localParticles[lid].velocity.w <= 0.0)
+        // Expired particles go back to the dead list for the spawn kernel to reuse
+        if (particle.velocity.w <= 0.0)
         {
-            // Generate random values for spherical coordinates
-            float u = fract(sin(float(gid) * 12.9898) * 43758.5453);
-            float v = fract(sin(float(gid) * 78.233) * 43758.5453);
-
-            // Spherical coordinates to cartesian
-            float theta = u * 2.0 * 3.14159;
-            float phi = acos(2.0 * v - 1.0);
-            float r = sphereRadius * pow(fract(sin(float(gid) * 34.567) * 43758.5453), 1.0 / 3.0);
-
-            localParticles[lid].position = vec4
-            (
-                particleEmitterCurrentPos.x + r * sin(phi) * cos(theta),
-                particleEmitterCurrentPos.y + r * sin(phi) * sin(theta),
-                particleEmitterCurrentPos.z + r * cos(phi),
-                1.0 + fract(sin(float(gid) * 56.789) * 43758.5453) * 0.5
-            );
-
-            localParticles[lid].color = vec4
-            (
-                0.9, 0.9, 0.9,
-                0.5 + 0.5 * fract(sin(float(gid) * 12.7) * 43758.5453)
-            );
-
-            localParticles[lid].velocity = vec4
-            (
-                mix(-0.2, 0.2, fract(sin(float(gid) * 32.8) * 43758.5453)),
-                0.5 + 0.5 * fract(sin(float(gid) * 94.2) * 43758.5453),
-                mix(-0.2, 0.2, fract(sin(float(gid) * 70.3) * 43758.5453)),
-                maxLifetime * fract(sin(float(gid) * 18.6) * 43758.5453)
-            );
+            alive = false;
+        }
+        else if (catchUpTick)
+        {
+            // Fast-forward after an off-screen sleep: one ballistic step over the whole gap.
+            // Forces, collisions and noise are integrated per tick and would blow up at this step.
+            vec3 baseDelta = emitter.position.xyz - emitter.previousPosition.xyz;
+            particle.position.xyz += particle.velocity.xyz * deltaTime + baseDelta * emitter.motion.x;
+            particle.position.w = particleSizeForAge(particle.velocity.w, maxLifetime);
+            particle.color.a = (particle.velocity.w / maxLifetime) * 0.7;
         }
         else
         {
+            // Vector fields accelerate particles and pull their velocity onto the field
+            for (int i = 0; i < vectorFieldCount; i++)
+            {
+                vec3 volumeCoord = (vectorFieldWorldToVolume[i] * vec4(particle.position.xyz, 1.0)).xyz;
+                if (any(lessThan(volumeCoord, vec3(0.0))) || any(greaterThan(volumeCoord, vec3(1.0))))
+                    continue;
+
+                vec3 fieldVelocity = mat3(vectorFieldToWorld[i]) * textureLod(vectorFields[i], volumeCoord, 0.0).xyz;
+                particle.velocity.xyz += fieldVelocity * vectorFieldForces[i].x * deltaTime;
+                particle.velocity.xyz = mix(particle.velocity.xyz, fieldVelocity, clamp(vectorFieldForces[i].y * deltaTime, 0.0, 1.0));
+            }
+
+#if USE_SPATIAL_GRID
+            // Neighbours come from the grid built at the start of the tick
+            particle.velocity.xyz += densityRepulsion(particle.position.xyz, gid) * deltaTime;
+#endif
+
+            // Attractors, vortices, wind, drag and gravity near this workgroup
+            if (forceCount > 0u)
+            {
+                applyForces(particle);
+            }
+
             // Update position based on velocity
-            localParticles[lid].position.xyz += (localParticles[lid].velocity.xyz * deltaTime);
+            particle.position.xyz += (particle.velocity.xyz * deltaTime);
+
+            // Follow the emitter as far as it asks
+            vec3 baseDelta = emitter.position.xyz - emitter.previousPosition.xyz;
+            particle.position.xyz += baseDelta * emitter.motion.x;
 
-            // Handle base position movement
-            vec3 baseDelta = particleEmitterCurrentPos - prevParticleEmitterPos;
-            localParticles[lid].position.xyz += baseDelta;
+            // Collide against the scene once the particle has moved
+            if (depthCollisionEnabled)
+            {
+                collideWithDepth(particle);
+            }
 
-            // Apply some wind effect
-            localParticles[lid].velocity.x += 0.05 * deltaTime * sin(localParticles[lid].position.y * 0.5 + deltaTime * 0.2);
+            // Analytic colliders and the heightfield; kill-on-contact releases the particle
+            if ((colliderCount > 0u || heightfieldEnabled) && collideWithColliders(particle))
+            {
+                alive = false;
+            }
 
             // Age-based scaling
-            float currentLifetime = localParticles[lid].velocity.w;
+            float currentLifetime = particle.velocity.w;
             float lifePercent = 1.0 - (currentLifetime / maxLifetime);
-
-            float minSize = 0.8;
-            float maxSize = 2.0;
-            localParticles[lid].position.w = mix(minSize, maxSize, lifePercent);
+            particle.position.w = particleSizeForAge(currentLifetime, maxLifetime);
 
             // Decrease opacity over time
-            localParticles[lid].color.a = (1.0 - lifePercent) * 0.7;
+            particle.color.a = (1.0 - lifePercent) * 0.7;
 
-            // Add some turbulence
-            float turbulenceX = sin(localParticles[lid].position.y * 8.0 + deltaTime) * 0.3;
-            float turbulenceZ = cos(localParticles[lid].position.y * 5.0 + deltaTime * 1.5) * 0.1;
-            localParticles[lid].position.x += turbulenceX * deltaTime;
-            localParticles[lid].position.z += turbulenceZ * deltaTime;
-
-            // Slow down as it rises
-            localParticles[lid].velocity.y *= (1.0 - 0.1 * deltaTime);
+            // Add some turbulence; one fetch regardless of how many octaves were baked
+            vec3 noiseCoord = particle.position.xyz * turbulenceScale + turbulenceScroll * simulationTime;
+            vec3 turbulence = textureLod(turbulenceField, noiseCoord, 0.0).xyz;
+            particle.position.xyz += turbulence * turbulenceStrength * deltaTime;
         }
     }
     else
     {
         // Fade out based on remaining lifetime after emitter destruction
         float fadeOutSpeed = 1.0;
-        localParticles[lid].color.a -= fadeOutSpeed * deltaTime;
-        localParticles[lid].color.a = max(localParticles[lid].color.a, 0.0);
+        particle.color.a -= fadeOutSpeed * deltaTime;
+        particle.color.a = max(particle.color.a, 0.0);
+
+        // Fully faded particles are released to the dead list
+        alive = particle.color.a > 0.0;
+    }
+
+    return alive;
+}
+
+void main()
+{
+    // The dispatch is sized from the alive count, so only the last group has spare invocations.
+    // They stay in the shader (rather than returning) so every invocation reaches the barriers.
+    bool active = gl_GlobalInvocationID.x < aliveCount;
+    uint gid = active ? aliveIndicesIn[gl_GlobalInvocationID.x] : 0u;
+    bool alive = false;
+
+#if USE_SHARED_STAGING
+    uint lid = gl_LocalInvocationID.x;
+
+    // Load particle into shared memory
+    if (active)
+    {
+        localParticles[lid] = loadParticle(gid);
+    }
+
+    // Synchronize to ensure all particles are loaded
+    barrier();
+
+    if (colliderCount > 0u || heightfieldEnabled || forceCount > 0u)
+    {
+        cullWorkgroup(active, localParticles[lid].position.xyz);
+    }
+
+    vec3 startPosition = localParticles[lid].position.xyz;
+    if (active)
+    {
+        alive = simulateParticle(localParticles[lid], gid);
+
+        // Nothing to interpolate across a catch-up jump
+        previousPositions[gid] = vec4(catchUpTick ? localParticles[lid].position.xyz : startPosition, 1.0);
     }
 
     // Synchronize before writing back to global memory
     barrier();
 
+    if (!active)
+        return;
+
     // Write back updated particle to global memory
-    particles[gid] = localParticles[lid];
+    storeParticle(gid, localParticles[lid]);
+#else
+    Particle particle = active ? loadParticle(gid) : Particle(vec4(0.0), vec4(0.0), vec4(0.0));
+
+    if (colliderCount > 0u || heightfieldEnabled || forceCount > 0u)
+    {
+        cullWorkgroup(active, particle.position.xyz);
+    }
+
+    if (!active)
+        return;
+
+    vec3 startPosition = particle.position.xyz;
+    alive = simulateParticle(particle, gid);
+    storeParticle(gid, particle);
+
+    // Nothing to interpolate across a catch-up jump
+    previousPositions[gid] = vec4(catchUpTick ? particle.position.xyz : startPosition, 1.0);
+#endif
+
+    if (alive)
+    {
+#if USE_TRAILS
+        // Only survivors record, so a slot reused this tick has no entry stamped with this tick.
+        // A catch-up tick records nothing either, so ribbons restart instead of spanning the jump.
+        if (!catchUpTick)
+        {
+            trailHistory[trailEntry(gid, frameIndex)] = uvec4(floatBitsToUint(startPosition), frameIndex);
+        }
+#endif
+        particleEmittersOut[gid] = particleEmitters[gid];
+        aliveIndicesOut[atomicAdd(aliveCountAfterSimulation, 1)] = gid;
+    }
+    else
+    {
+        deadIndices[uint(atomicAdd(deadCount, 1))] = gid;
+    }
 }
\ No newline at end of file
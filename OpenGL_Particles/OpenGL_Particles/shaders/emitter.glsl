@@ -0,0 +1,26 @@
+#ifndef EMITTER_GLSL
+#define EMITTER_GLSL
+
+// One row of the emitter table; mirrors EmitterData in ParticleSystem.h (std430, 96 bytes)
+struct Emitter
+{
+    vec4 position;           // xyz = location at the end of this tick, w = sphere radius
+    vec4 previousPosition;   // xyz = location at the start of this tick, w = max lifetime
+    vec4 textureRegion;      // xy = UV extent of the sprite sheet in its layer, z = layer
+    ivec4 gridSize;          // xy = flipbook grid
+    uvec4 state;             // x = unused, y = RNG seed, z = alive
+    vec4 motion;             // x = share of the emitter's motion live particles follow, y = share of its velocity new ones inherit
+};
+
+// Billboard size over a particle's life. The update kernel stores it in position.w; the
+// packed layout has no room for it, so the vertex shader recomputes it from the lifetime.
+float particleSizeForAge(float lifetime, float maxLifetime)
+{
+    float lifePercent = 1.0 - (lifetime / maxLifetime);
+
+    float minSize = 0.8;
+    float maxSize = 2.0;
+    return mix(minSize, maxSize, lifePercent);
+}
+
+#endif
@@ -0,0 +1,126 @@
+#version 460 core
+
+layout(local_size_x = 64) in;
+
+#include "emitter.glsl"
+#include "parameters.glsl"
+
+// Path types; mirror EmitterPathType in EmitterPath.h
+#define PATH_STATIC 0u
+#define PATH_SWAY 1u
+#define PATH_ORBIT 2u
+#define PATH_LINEAR 3u
+#define PATH_SPLINE 4u
+
+// One path per emitter; mirrors EmitterPathData in EmitterPath.h (std430, 64 bytes)
+struct EmitterPath
+{
+    vec4 origin;    // xyz = emitter location, w = orbit radius
+    vec4 vector;    // xyz = sway amplitude or orbit axis, w = frequency
+    vec4 params;    // x = phase, y = duration of the keys
+    uvec4 info;     // x = type, y = first key, z = key count, w = loop
+};
+
+// Only the locations are written here; the rest of the table is set up once by the CPU
+layout(std430, binding = 7) buffer EmitterTable
+{
+    Emitter emitters[];
+};
+
+layout(std430, binding = 24) readonly buffer EmitterPaths
+{
+    EmitterPath paths[];
+};
+
+// Keys of every keyed path: xyz = position relative to the emitter location, w = time
+layout(std430, binding = 25) readonly buffer EmitterPathKeys
+{
+    vec4 pathKeys[];
+};
+
+// Key i of a path. Spline neighbours past either end wrap on a looping path, skipping the
+// closing key so the seam stays smooth, and clamp on the others.
+vec4 pathKey(EmitterPath path, int i)
+{
+    int count = int(path.info.z);
+    if (path.info.w != 0u && count > 2)
+    {
+        if (i < 0)
+            i += count - 1;
+        else if (i >= count)
+            i -= count - 1;
+    }
+
+    return pathKeys[path.info.y + uint(clamp(i, 0, count - 1))];
+}
+
+vec3 evaluateKeyedPath(EmitterPath path, float time)
+{
+    int count = int(path.info.z);
+    float start = pathKey(path, 0).w;
+    float duration = path.params.y;
+
+    if (path.info.w != 0u && duration > 0.0)
+    {
+        time = start + mod(time - start, duration);
+    }
+
+    // Paths have few keys, so a linear scan finds the segment
+    int segment = 0;
+    while (segment < count - 2 && pathKey(path, segment + 1).w <= time)
+    {
+        segment++;
+    }
+
+    vec4 from = pathKey(path, segment);
+    vec4 to = pathKey(path, min(segment + 1, count - 1));
+    float u = clamp((time - from.w) / max(to.w - from.w, 1e-6), 0.0, 1.0);
+
+    if (path.info.x == PATH_LINEAR)
+        return mix(from.xyz, to.xyz, u);
+
+    // Catmull-Rom through the keys either side of the segment
+    vec3 before = pathKey(path, segment - 1).xyz;
+    vec3 after = pathKey(path, segment + 2).xyz;
+    return 0.5 * (2.0 * from.xyz
+        + (to.xyz - before) * u
+        + (2.0 * before - 5.0 * from.xyz + 4.0 * to.xyz - after) * u * u
+        + (3.0 * from.xyz - before - 3.0 * to.xyz + after) * u * u * u);
+}
+
+vec3 evaluatePath(EmitterPath path, float time)
+{
+    uint type = path.info.x;
+    vec3 location = path.origin.xyz;
+    float angle = path.vector.w * time + path.params.x;
+
+    if (type == PATH_SWAY)
+        return location + path.vector.xyz * sin(angle);
+
+    if (type == PATH_ORBIT)
+    {
+        // Any two directions perpendicular to the axis span the orbit plane
+        vec3 axis = path.vector.xyz;
+        vec3 tangent = normalize(cross(axis, abs(axis.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0)));
+        vec3 bitangent = cross(axis, tangent);
+        return location + (tangent * cos(angle) + bitangent * sin(angle)) * path.origin.w;
+    }
+
+    if (type == PATH_LINEAR || type == PATH_SPLINE)
+        return location + evaluateKeyedPath(path, time);
+
+    return location;
+}
+
+// One invocation per emitter, at the start of every tick
+void main()
+{
+    uint emitterId = gl_GlobalInvocationID.x;
+    if (emitterId >= uint(paths.length()))
+        return;
+
+    // The tick advances from simulationTime to simulationTime + deltaTime
+    EmitterPath path = paths[emitterId];
+    emitters[emitterId].previousPosition.xyz = evaluatePath(path, simulationTime);
+    emitters[emitterId].position.xyz = evaluatePath(path, simulationTime + deltaTime);
+}
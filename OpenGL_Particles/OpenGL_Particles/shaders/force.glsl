@@ -0,0 +1,96 @@
+#ifndef FORCE_GLSL
+#define FORCE_GLSL
+
+// Types and falloffs; mirror ForceType / ForceFalloff in ForceField.h
+#define FORCE_ATTRACTOR 0u
+#define FORCE_VORTEX 1u
+#define FORCE_WIND 2u
+#define FORCE_DRAG 3u
+#define FORCE_GRAVITY 4u
+
+#define FALLOFF_NONE 0u
+#define FALLOFF_LINEAR 1u
+#define FALLOFF_SMOOTH 2u
+#define FALLOFF_INVERSE_SQUARE 3u
+
+// One force; mirrors ForceData in ForceField.h (std430, 96 bytes)
+struct Force
+{
+    vec4 position;     // xyz = influence centre, w = influence radius (0 = unbounded)
+    vec4 vector;       // vortex: axis; wind: direction; drag: per-axis coefficients; gravity: acceleration
+    vec4 params;       // x = strength, y = vortex inward pull
+    uvec4 info;        // x = type, y = falloff
+    vec4 boundsMin;    // world AABB for per-workgroup culling
+    vec4 boundsMax;
+};
+
+// Weight of the force at a distance from its centre; 0 outside the influence volume
+float forceFalloff(Force force, float distanceToCentre)
+{
+    float radius = force.position.w;
+    if (radius <= 0.0)
+        return 1.0;
+
+    float t = distanceToCentre / radius;
+    if (t >= 1.0)
+        return 0.0;
+
+    uint falloff = force.info.y;
+    if (falloff == FALLOFF_LINEAR)
+        return 1.0 - t;
+    if (falloff == FALLOFF_SMOOTH)
+        return (1.0 - t * t) * (1.0 - t * t);
+    if (falloff == FALLOFF_INVERSE_SQUARE)
+        return 1.0 / (1.0 + 24.0 * t * t) - t / 25.0;
+
+    return 1.0;
+}
+
+// Applies one force to a velocity over deltaTime
+vec3 applyForce(Force force, vec3 position, vec3 velocity, float deltaTime)
+{
+    vec3 toCentre = force.position.xyz - position;
+    float weight = forceFalloff(force, length(toCentre));
+    if (weight <= 0.0)
+        return velocity;
+
+    float strength = force.params.x * weight;
+    uint type = force.info.x;
+
+    if (type == FORCE_ATTRACTOR)
+    {
+        float distanceToCentre = length(toCentre);
+        if (distanceToCentre > 1e-5)
+        {
+            velocity += (toCentre / distanceToCentre) * strength * deltaTime;
+        }
+    }
+    else if (type == FORCE_VORTEX)
+    {
+        // Offset from the axis, perpendicular to it
+        vec3 axis = force.vector.xyz;
+        vec3 radial = -toCentre - axis * dot(-toCentre, axis);
+        float radialLength = length(radial);
+        if (radialLength > 1e-5)
+        {
+            vec3 outward = radial / radialLength;
+            velocity += (cross(axis, outward) * strength - outward * force.params.y * weight) * deltaTime;
+        }
+    }
+    else if (type == FORCE_WIND)
+    {
+        velocity += force.vector.xyz * strength * deltaTime;
+    }
+    else if (type == FORCE_DRAG)
+    {
+        velocity *= max(vec3(1.0) - force.vector.xyz * strength * deltaTime, vec3(0.0));
+    }
+    else if (type == FORCE_GRAVITY)
+    {
+        velocity += force.vector.xyz * strength * deltaTime;
+    }
+
+    return velocity;
+}
+
+#endif
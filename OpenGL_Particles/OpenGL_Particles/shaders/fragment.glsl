@@ -2,14 +2,16 @@
 
 in vec2 TexCoord;
 in vec4 ParticleColor;
+flat in vec3 SpriteRegion;
 
 out vec4 FragColor;
 
-uniform sampler2D smokeTexture;
+// Every emitter's sprite sheet, one per layer
+uniform sampler2DArray spriteSheets;
 
 void main() {
-    // Sample the texture
-    vec4 texColor = texture(smokeTexture, TexCoord);
+    // Sample the texture from the sheet's region of its layer
+    vec4 texColor = texture(spriteSheets, vec3(TexCoord * SpriteRegion.xy, SpriteRegion.z));
 
     // Combine with particle color
     FragColor = texColor * ParticleColor;
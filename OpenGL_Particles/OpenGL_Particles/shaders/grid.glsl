@@ -0,0 +1,39 @@
+#ifndef GRID_GLSL
+#define GRID_GLSL
+
+// Hashed uniform grid built by grid_histogram / grid_scan / grid_scatter; see SpatialGrid.h.
+// The sizes come from SpatialGrid::defines().
+#ifndef GRID_CELL_SIZE
+#define GRID_CELL_SIZE 0.25
+#endif
+
+#ifndef GRID_CELL_COUNT
+#define GRID_CELL_COUNT 262144
+#endif
+
+// x = first slot of the cell in gridSortedParticles, y = particles in the cell
+layout(std430, binding = 9) buffer GridCells
+{
+    uvec2 gridCells[];
+};
+
+// Alive particles in cell order: xyz = position (float bits), w = particle slot.
+// Kept as uints so the slot never passes through a float register as a denormal.
+layout(std430, binding = 10) buffer GridSortedParticles
+{
+    uvec4 gridSortedParticles[];
+};
+
+ivec3 gridCellCoord(vec3 position)
+{
+    return ivec3(floor(position / GRID_CELL_SIZE));
+}
+
+// Unbounded cell coordinates fold into a fixed table; collisions only cost extra distance tests
+uint gridCellHash(ivec3 cell)
+{
+    uvec3 hashed = uvec3(cell) * uvec3(73856093u, 19349663u, 83492791u);
+    return (hashed.x ^ hashed.y ^ hashed.z) & uint(GRID_CELL_COUNT - 1);
+}
+
+#endif
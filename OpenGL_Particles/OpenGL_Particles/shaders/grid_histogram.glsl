@@ -0,0 +1,40 @@
+#version 460 core
+
+#ifndef WORK_GROUP_SIZE
+#define WORK_GROUP_SIZE 256
+#endif
+
+layout(local_size_x = WORK_GROUP_SIZE) in;
+
+#include "grid.glsl"
+#include "particle_layout.glsl"
+
+layout(std430, binding = 2) readonly buffer AliveListIn
+{
+    uint aliveIndicesIn[];
+};
+
+layout(std430, binding = 4) readonly buffer Counters
+{
+    uint aliveCount;
+    uint aliveCountAfterSimulation;
+    int deadCount;
+};
+
+// Per alive list entry: x = cell, y = rank within the cell
+layout(std430, binding = 11) writeonly buffer GridParticleCells
+{
+    uvec2 gridParticleCells[];
+};
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= aliveCount)
+        return;
+
+    uint cell = gridCellHash(gridCellCoord(loadParticlePosition(aliveIndicesIn[index]).xyz));
+    uint rank = atomicAdd(gridCells[cell].y, 1u);
+
+    gridParticleCells[index] = uvec2(cell, rank);
+}
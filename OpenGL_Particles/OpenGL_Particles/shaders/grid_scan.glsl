@@ -0,0 +1,68 @@
+#version 460 core
+
+// Must match SpatialGrid::scanBlockSize
+#define SCAN_BLOCK_SIZE 1024
+
+// 0 = scan each block of cell counts, 1 = scan the block totals, 2 = add them back
+#ifndef SCAN_PASS
+#define SCAN_PASS 0
+#endif
+
+layout(local_size_x = SCAN_BLOCK_SIZE) in;
+
+#include "grid.glsl"
+
+layout(std430, binding = 12) buffer GridBlockSums
+{
+    uint gridBlockSums[];
+};
+
+shared uint scratch[SCAN_BLOCK_SIZE];
+
+// Inclusive scan of scratch across the workgroup
+void scanScratch(uint lid)
+{
+    for (uint offset = 1u; offset < SCAN_BLOCK_SIZE; offset <<= 1u)
+    {
+        uint addend = lid >= offset ? scratch[lid - offset] : 0u;
+        barrier();
+        scratch[lid] += addend;
+        barrier();
+    }
+}
+
+void main()
+{
+    uint lid = gl_LocalInvocationID.x;
+
+#if SCAN_PASS == 0
+    // Cell starts relative to the block, and the block's total
+    uint cell = gl_GlobalInvocationID.x;
+    uint count = gridCells[cell].y;
+
+    scratch[lid] = count;
+    barrier();
+    scanScratch(lid);
+
+    gridCells[cell].x = scratch[lid] - count;
+    if (lid == SCAN_BLOCK_SIZE - 1)
+    {
+        gridBlockSums[gl_WorkGroupID.x] = scratch[lid];
+    }
+#elif SCAN_PASS == 1
+    // Block totals become block offsets; a single workgroup covers them all
+    uint blockCount = uint(GRID_CELL_COUNT / SCAN_BLOCK_SIZE);
+    uint total = lid < blockCount ? gridBlockSums[lid] : 0u;
+
+    scratch[lid] = total;
+    barrier();
+    scanScratch(lid);
+
+    if (lid < blockCount)
+    {
+        gridBlockSums[lid] = scratch[lid] - total;
+    }
+#else
+    gridCells[gl_GlobalInvocationID.x].x += gridBlockSums[gl_WorkGroupID.x];
+#endif
+}
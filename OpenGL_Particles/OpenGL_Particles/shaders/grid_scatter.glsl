@@ -0,0 +1,40 @@
+#version 460 core
+
+#ifndef WORK_GROUP_SIZE
+#define WORK_GROUP_SIZE 256
+#endif
+
+layout(local_size_x = WORK_GROUP_SIZE) in;
+
+#include "grid.glsl"
+#include "particle_layout.glsl"
+
+layout(std430, binding = 2) readonly buffer AliveListIn
+{
+    uint aliveIndicesIn[];
+};
+
+layout(std430, binding = 4) readonly buffer Counters
+{
+    uint aliveCount;
+    uint aliveCountAfterSimulation;
+    int deadCount;
+};
+
+layout(std430, binding = 11) readonly buffer GridParticleCells
+{
+    uvec2 gridParticleCells[];
+};
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= aliveCount)
+        return;
+
+    uint gid = aliveIndicesIn[index];
+    uvec2 cellRank = gridParticleCells[index];
+
+    // Positions are copied so neighbour loops read one contiguous run per cell
+    gridSortedParticles[gridCells[cellRank.x].x + cellRank.y] = uvec4(floatBitsToUint(loadParticlePosition(gid).xyz), gid);
+}
@@ -0,0 +1,59 @@
+#version 460 core
+
+layout(local_size_x = 1) in;
+
+layout(std430, binding = 4) buffer Counters
+{
+    uint aliveCount;
+    uint aliveCountAfterSimulation;
+    int deadCount;
+};
+
+// DispatchIndirectCommand followed by the billboard and ribbon DrawArraysIndirectCommands
+layout(std430, binding = 5) buffer IndirectArgs
+{
+    uint dispatchX;
+    uint dispatchY;
+    uint dispatchZ;
+    uint pad;
+
+    uint drawVertexCount;
+    uint drawInstanceCount;
+    uint drawFirstVertex;
+    uint drawBaseInstance;
+
+    uint ribbonVertexCount;
+    uint ribbonInstanceCount;
+    uint ribbonFirstVertex;
+    uint ribbonBaseInstance;
+};
+
+uniform int workGroupSize;
+
+// Two vertices per trail point; 0 when trails are off
+uniform int ribbonStripVertices;
+
+void main()
+{
+    // The output alive list becomes next update's input
+    uint alive = aliveCountAfterSimulation;
+    aliveCount = alive;
+    aliveCountAfterSimulation = 0;
+
+    // Size the next update by the real alive count
+    dispatchX = (alive + uint(workGroupSize) - 1) / uint(workGroupSize);
+    dispatchY = 1;
+    dispatchZ = 1;
+
+    // Billboard quad instanced once per alive particle
+    drawVertexCount = 4;
+    drawInstanceCount = alive;
+    drawFirstVertex = 0;
+    drawBaseInstance = 0;
+
+    // Ribbon strip instanced once per alive particle
+    ribbonVertexCount = uint(ribbonStripVertices);
+    ribbonInstanceCount = alive;
+    ribbonFirstVertex = 0;
+    ribbonBaseInstance = 0;
+}
\ No newline at end of file
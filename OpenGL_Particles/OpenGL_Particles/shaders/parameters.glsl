@@ -0,0 +1,53 @@
+#ifndef PARAMETERS_GLSL
+#define PARAMETERS_GLSL
+
+// Must match maxVectorFields in ParticleSystem.h
+#define MAX_VECTOR_FIELDS 4
+
+// Every per-system parameter, shared by the update, spawn and render programs.
+// Mirrors SimulationParameters in ParticleSystem.h (std140).
+layout(std140, binding = 0) uniform SimulationParameters
+{
+    // Camera
+    mat4 viewProjMatrix;
+    mat4 viewMatrix;
+
+    // Scene depth the update kernel collides against, with the matrices it was rendered with
+    mat4 depthViewProjection;
+    mat4 depthInverseViewProjection;
+
+    // Imported vector fields
+    mat4 vectorFieldWorldToVolume[MAX_VECTOR_FIELDS];
+    mat4 vectorFieldToWorld[MAX_VECTOR_FIELDS];       // rotation and scale in the upper 3x3
+    vec4 vectorFieldForces[MAX_VECTOR_FIELDS];        // x = intensity, y = tightness
+
+    vec3 turbulenceScroll;        // volume units per second
+    float turbulenceScale;        // volume units per world unit
+    vec3 depthCameraPosition;
+    float turbulenceStrength;
+    vec3 heightfieldOrigin;       // world position of the heightfield's (0, 0) corner
+    float heightfieldScale;
+    vec3 heightfieldResponse;     // x = restitution, y = friction, z = kill on contact
+    float deltaTime;
+    vec2 depthTexelSize;
+    vec2 heightfieldSize;         // world extent along x and z
+
+    float simulationTime;
+    float interpolationAlpha;     // fraction of a tick elapsed since the last update
+    float collisionRestitution;
+    float collisionFriction;
+    float collisionThickness;
+    float densityRadius;
+    float densityStrength;
+    int densityMaxNeighbours;
+    int vectorFieldCount;
+    uint colliderCount;
+    uint forceCount;
+    uint frameIndex;              // key for the counter-based RNG
+    bool depthCollisionEnabled;
+    bool heightfieldEnabled;
+    float trailWidth;             // ribbon width at the particle, tapering to zero at the tail
+    bool catchUpTick;             // set for the single coarse tick that fast-forwards a woken system
+};
+
+#endif
@@ -0,0 +1,226 @@
+#ifndef PARTICLE_LAYOUT_GLSL
+#define PARTICLE_LAYOUT_GLSL
+
+// Storage layouts; mirror ParticleLayout in ParticleSystem.h, which picks one with PARTICLE_LAYOUT
+#define PARTICLE_LAYOUT_AOS 0
+#define PARTICLE_LAYOUT_SOA 1
+#define PARTICLE_LAYOUT_PACKED 2
+
+#ifndef PARTICLE_LAYOUT
+#define PARTICLE_LAYOUT PARTICLE_LAYOUT_AOS
+#endif
+
+struct Particle
+{
+    vec4 position;   // xyz = position, w = size
+    vec4 color;      // rgba = color
+    vec4 velocity;   // xyz = velocity, w = lifetime
+};
+
+// Shaders go through these accessors, so only the streams they touch are read or written.
+// State is double-buffered: loads read the set bound at 0/15/16/17, stores write the set
+// bound at 18-21, so a tick never writes what the previous frame's draw is reading.
+
+#if PARTICLE_LAYOUT == PARTICLE_LAYOUT_AOS
+
+layout(std430, binding = 0) readonly buffer ParticleBuffer
+{
+    Particle particles[];
+};
+
+layout(std430, binding = 18) writeonly buffer ParticleBufferOut
+{
+    Particle particlesOut[];
+};
+
+vec4 loadParticlePosition(uint slot)
+{
+    return particles[slot].position;
+}
+
+vec4 loadParticleColor(uint slot)
+{
+    return particles[slot].color;
+}
+
+vec4 loadParticleVelocity(uint slot)
+{
+    return particles[slot].velocity;
+}
+
+float loadParticleLifetime(uint slot)
+{
+    return particles[slot].velocity.w;
+}
+
+void storeParticle(uint slot, Particle particle)
+{
+    particlesOut[slot] = particle;
+}
+
+#elif PARTICLE_LAYOUT == PARTICLE_LAYOUT_PACKED
+
+// 24 bytes per particle: full-precision position, half-float velocity and lifetime, unorm8
+// color. Size is not stored; it follows from the age, see particleSizeForAge in emitter.glsl.
+// Scalars only, so std430 packs the array without vec3 padding.
+
+#include "random.glsl"
+
+struct PackedParticle
+{
+    float positionX;
+    float positionY;
+    float positionZ;
+    uint velocityXY;          // half2
+    uint velocityZLifetime;   // half2
+    uint color;               // unorm8 x 4
+};
+
+layout(std430, binding = 0) readonly buffer PackedParticleBuffer
+{
+    PackedParticle packedParticles[];
+};
+
+layout(std430, binding = 18) writeonly buffer PackedParticleBufferOut
+{
+    PackedParticle packedParticlesOut[];
+};
+
+// w is 0: the packed layout has no stored size
+vec4 loadParticlePosition(uint slot)
+{
+    return vec4(packedParticles[slot].positionX, packedParticles[slot].positionY, packedParticles[slot].positionZ, 0.0);
+}
+
+vec4 loadParticleColor(uint slot)
+{
+    return unpackUnorm4x8(packedParticles[slot].color);
+}
+
+vec4 loadParticleVelocity(uint slot)
+{
+    return vec4(unpackHalf2x16(packedParticles[slot].velocityXY), unpackHalf2x16(packedParticles[slot].velocityZLifetime));
+}
+
+float loadParticleLifetime(uint slot)
+{
+    return unpackHalf2x16(packedParticles[slot].velocityZLifetime).y;
+}
+
+// Rounds to one of the two nearest halves, with odds by distance. Per-tick increments
+// below half a ulp (light forces on fast particles, lifetime countdown) would otherwise
+// round away every tick; this way they survive on average.
+uint packHalfStochastic(float value, float noise)
+{
+    uint nearest = packHalf2x16(vec2(value, 0.0));
+    float rounded = unpackHalf2x16(nearest).x;
+    if (rounded == value || isnan(value))
+    {
+        return nearest;
+    }
+
+    // Halves are sign-magnitude, so the other neighbour is one step up or down in magnitude
+    uint other = abs(value) > abs(rounded) ? nearest + 1u : nearest - 1u;
+    float otherRounded = unpackHalf2x16(other).x;
+
+    return noise < (value - rounded) / (otherRounded - rounded) ? other : nearest;
+}
+
+void storeParticle(uint slot, Particle particle)
+{
+    // Dither keyed by the slot and the new position, so it changes every tick
+    uvec4 noiseBits = pcg4d(uvec4(slot, floatBitsToUint(particle.position.xyz)));
+    vec4 noise = rngToUnitFloat4(noiseBits);
+    vec4 colorNoise = rngToUnitFloat4(pcg4d(noiseBits)) - 0.5;
+
+    packedParticlesOut[slot] = PackedParticle
+    (
+        particle.position.x,
+        particle.position.y,
+        particle.position.z,
+        packHalfStochastic(particle.velocity.x, noise.x) | (packHalfStochastic(particle.velocity.y, noise.y) << 16u),
+        packHalfStochastic(particle.velocity.z, noise.z) | (packHalfStochastic(particle.velocity.w, noise.w) << 16u),
+        packUnorm4x8(particle.color + colorNoise / 255.0)
+    );
+}
+
+#else
+
+// One stream per attribute, bound as ranges of the same buffer. Lifetime has its own
+// stream so drawing (which needs it for the flipbook) never pulls in velocity.
+layout(std430, binding = 0) readonly buffer ParticlePositions
+{
+    vec4 particlePositions[];   // xyz = position, w = size
+};
+
+layout(std430, binding = 15) readonly buffer ParticleColors
+{
+    vec4 particleColors[];
+};
+
+layout(std430, binding = 16) readonly buffer ParticleVelocities
+{
+    vec4 particleVelocities[];  // xyz = velocity, w unused
+};
+
+layout(std430, binding = 17) readonly buffer ParticleLifetimes
+{
+    float particleLifetimes[];
+};
+
+layout(std430, binding = 18) writeonly buffer ParticlePositionsOut
+{
+    vec4 particlePositionsOut[];
+};
+
+layout(std430, binding = 19) writeonly buffer ParticleColorsOut
+{
+    vec4 particleColorsOut[];
+};
+
+layout(std430, binding = 20) writeonly buffer ParticleVelocitiesOut
+{
+    vec4 particleVelocitiesOut[];
+};
+
+layout(std430, binding = 21) writeonly buffer ParticleLifetimesOut
+{
+    float particleLifetimesOut[];
+};
+
+vec4 loadParticlePosition(uint slot)
+{
+    return particlePositions[slot];
+}
+
+vec4 loadParticleColor(uint slot)
+{
+    return particleColors[slot];
+}
+
+vec4 loadParticleVelocity(uint slot)
+{
+    return vec4(particleVelocities[slot].xyz, particleLifetimes[slot]);
+}
+
+float loadParticleLifetime(uint slot)
+{
+    return particleLifetimes[slot];
+}
+
+void storeParticle(uint slot, Particle particle)
+{
+    particlePositionsOut[slot] = particle.position;
+    particleColorsOut[slot] = particle.color;
+    particleVelocitiesOut[slot] = vec4(particle.velocity.xyz, 0.0);
+    particleLifetimesOut[slot] = particle.velocity.w;
+}
+
+#endif
+
+Particle loadParticle(uint slot)
+{
+    return Particle(loadParticlePosition(slot), loadParticleColor(slot), loadParticleVelocity(slot));
+}
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef RANDOM_GLSL
+#define RANDOM_GLSL
+
+// Counter-based random numbers: every draw is a pure hash of
+// (spawn index, frame, emitter seed, draw counter), so there is no state to
+// store per particle and any draw can be reproduced on the CPU.
+// systems/ParticleRandom.h is the bit-exact C++ twin; keep the two in sync.
+
+struct Rng
+{
+    uvec4 key;   // x = spawn index within the tick, y = frame, z = emitter seed, w = draw counter
+};
+
+// PCG4D hash (Jarzynski & Olano, "Hash Functions for GPU Rendering", 2020)
+uvec4 pcg4d(uvec4 v)
+{
+    v = v * 1664525u + 1013904223u;
+
+    v.x += v.y * v.w;
+    v.y += v.z * v.x;
+    v.z += v.x * v.y;
+    v.w += v.y * v.z;
+
+    v ^= v >> 16u;
+
+    v.x += v.y * v.w;
+    v.y += v.z * v.x;
+    v.z += v.x * v.y;
+    v.w += v.y * v.z;
+
+    return v;
+}
+
+Rng rngCreate(uint spawnIndex, uint frame, uint seed)
+{
+    return Rng(uvec4(spawnIndex, frame, seed, 0u));
+}
+
+uvec4 rngNextUint4(inout Rng rng)
+{
+    uvec4 bits = pcg4d(rng.key);
+    rng.key.w++;
+    return bits;
+}
+
+// Top 24 bits -> [0, 1); exact in single precision, so it matches the CPU bit for bit
+vec4 rngToUnitFloat4(uvec4 bits)
+{
+    return vec4(bits >> 8u) * (1.0 / 16777216.0);
+}
+
+vec4 rngNextFloat4(inout Rng rng)
+{
+    return rngToUnitFloat4(rngNextUint4(rng));
+}
+
+// Uniform point inside a ball of the given radius from three unit floats
+vec3 rngPointInSphere(vec3 u, float radius)
+{
+    float theta = u.x * 6.28318530718;
+    float cosPhi = 2.0 * u.y - 1.0;
+    float sinPhi = sqrt(max(0.0, 1.0 - cosPhi * cosPhi));
+    float r = radius * pow(u.z, 1.0 / 3.0);
+
+    return r * vec3(sinPhi * cos(theta), sinPhi * sin(theta), cosPhi);
+}
+
+#endif
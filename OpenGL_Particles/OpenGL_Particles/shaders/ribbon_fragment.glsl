@@ -0,0 +1,13 @@
+#version 460 core
+
+in vec4 RibbonColor;
+in float RibbonSide;
+
+out vec4 FragColor;
+
+void main()
+{
+    // Soft edges across the strip
+    FragColor = RibbonColor;
+    FragColor.a *= 1.0 - smoothstep(0.6, 1.0, abs(RibbonSide));
+}
@@ -0,0 +1,69 @@
+#version 460 core
+
+#include "parameters.glsl"
+#include "particle_layout.glsl"
+#include "trail.glsl"
+
+out vec4 RibbonColor;
+out float RibbonSide;   // -1 and 1 on the two edges of the strip
+
+// Alive slots written by the last update, one ribbon each
+layout(std430, binding = 2) readonly buffer AliveList
+{
+    uint aliveIndices[];
+};
+
+// Position before the latest tick, for render-time interpolation
+layout(std430, binding = 6) readonly buffer PreviousPositions
+{
+    vec4 previousPositions[];
+};
+
+// Entry `age` ticks back from the tick that read the drawn state set. That tick may still be
+// writing its own entry, so the history starts one tick back.
+uvec4 trailSample(uint slot, int age)
+{
+    return trailHistory[trailEntry(slot, frameIndex - uint(age))];
+}
+
+// Point 0 is the particle itself, interpolated like its billboard; the rest run back in time
+vec3 trailPoint(uint slot, vec3 head, int point)
+{
+    return point == 0 ? head : uintBitsToFloat(trailSample(slot, point).xyz);
+}
+
+void main()
+{
+    uint particleIndex = aliveIndices[gl_InstanceID];
+    vec3 head = mix(previousPositions[particleIndex].xyz, loadParticlePosition(particleIndex).xyz, interpolationAlpha);
+
+    // The particle's own history ends at the first entry stamped with another tick
+    int pointCount = 1;
+    while (pointCount < TRAIL_LENGTH && trailSample(particleIndex, pointCount).w == frameIndex - uint(pointCount))
+    {
+        pointCount++;
+    }
+
+    // Two vertices per point; points past the end of a young particle's history collapse onto its tail
+    int point = min(gl_VertexID / 2, pointCount - 1);
+    RibbonSide = (gl_VertexID & 1) == 0 ? -1.0 : 1.0;
+
+    vec3 position = trailPoint(particleIndex, head, point);
+    vec3 tangent = trailPoint(particleIndex, head, max(point - 1, 0)) - trailPoint(particleIndex, head, min(point + 1, pointCount - 1));
+
+    // Widen across the trail, facing the camera
+    vec3 cameraPosition = -transpose(mat3(viewMatrix)) * viewMatrix[3].xyz;
+    vec3 across = cross(tangent, cameraPosition - position);
+    if (dot(across, across) < 1e-12)
+    {
+        across = vec3(viewMatrix[0][0], viewMatrix[1][0], viewMatrix[2][0]);
+    }
+
+    float taper = 1.0 - float(gl_VertexID / 2) / float(TRAIL_LENGTH - 1);
+    position += normalize(across) * RibbonSide * 0.5 * trailWidth * taper;
+
+    RibbonColor = loadParticleColor(particleIndex);
+    RibbonColor.a *= taper;
+
+    gl_Position = viewProjMatrix * vec4(position, 1.0);
+}
@@ -0,0 +1,128 @@
+#version 460 core
+
+layout(local_size_x = 64) in;
+
+#include "random.glsl"
+#include "emitter.glsl"
+#include "parameters.glsl"
+#include "particle_layout.glsl"
+
+layout(std430, binding = 1) readonly buffer DeadList
+{
+    uint deadIndices[];
+};
+
+// New particles join the list the update kernel just produced
+layout(std430, binding = 3) writeonly buffer AliveListOut
+{
+    uint aliveIndicesOut[];
+};
+
+layout(std430, binding = 4) buffer Counters
+{
+    uint aliveCount;
+    uint aliveCountAfterSimulation;
+    int deadCount;
+};
+
+// Position before the latest tick, for render-time interpolation
+layout(std430, binding = 6) writeonly buffer PreviousPositions
+{
+    vec4 previousPositions[];
+};
+
+layout(std430, binding = 7) readonly buffer EmitterTable
+{
+    Emitter emitters[];
+};
+
+// Emitter id of every particle slot, in the state set this tick writes
+layout(std430, binding = 22) writeonly buffer ParticleEmittersOut
+{
+    uint particleEmittersOut[];
+};
+
+// Particles each emitter releases this tick, counted on the CPU
+layout(std430, binding = 26) readonly buffer EmitterSpawnCounts
+{
+    uint emitterSpawnCounts[];
+};
+
+// One workgroup per emitter; its invocations stride over that emitter's spawn count
+void main()
+{
+    uint emitterId = gl_WorkGroupID.x;
+    Emitter emitter = emitters[emitterId];
+
+    float sphereRadius = emitter.position.w;
+    float maxLifetime = emitter.previousPosition.w;
+    uint spawnCount = emitterSpawnCounts[emitterId];
+    vec3 emitterVelocity = (emitter.position.xyz - emitter.previousPosition.xyz) / deltaTime;
+
+    for (uint spawnIndex = gl_LocalInvocationID.x; spawnIndex < spawnCount; spawnIndex += gl_WorkGroupSize.x)
+    {
+        // Keyed by spawn index, frame and emitter, so every spawn draws fresh numbers before it
+        // claims a slot
+        Rng rng = rngCreate(spawnIndex, frameIndex, emitter.state.y);
+        vec4 shapeRandom = rngNextFloat4(rng);
+        vec4 motionRandom = rngNextFloat4(rng);
+        vec4 lifeRandom = rngNextFloat4(rng);
+
+        // Births are spread over the tick, one jittered stratum per particle, and each starts
+        // where the emitter was at that moment, so a fast emitter leaves a stream instead of
+        // clumps. The latest births come first, so a pool that runs dry keeps the youngest.
+        float birth = 1.0 - (float(spawnIndex) + lifeRandom.y) / float(spawnCount);
+        float remainingTime = (1.0 - birth) * deltaTime;
+        vec3 birthLocation = mix(emitter.previousPosition.xyz, emitter.position.xyz, birth);
+
+        // A particle that would already have expired by the end of the tick takes no slot;
+        // after a long catch-up tick that is most of the early births
+        float lifetime = maxLifetime * lifeRandom.x;
+        if (lifetime <= remainingTime)
+            continue;
+
+        // Pop a free slot; give the claim back if the dead list ran dry
+        int deadSlot = atomicAdd(deadCount, -1) - 1;
+        if (deadSlot < 0)
+        {
+            atomicAdd(deadCount, 1);
+            return;
+        }
+
+        uint gid = deadIndices[deadSlot];
+
+        Particle particle;
+
+        particle.position = vec4
+        (
+            birthLocation + rngPointInSphere(shapeRandom.xyz, sphereRadius),
+            1.0 + shapeRandom.w * 0.5
+        );
+
+        particle.color = vec4
+        (
+            0.9, 0.9, 0.9,
+            0.5 + 0.5 * motionRandom.x
+        );
+
+        particle.velocity = vec4
+        (
+            mix(-0.2, 0.2, motionRandom.y),
+            0.5 + 0.5 * motionRandom.z,
+            mix(-0.2, 0.2, motionRandom.w),
+            lifetime
+        );
+        particle.velocity.xyz += emitterVelocity * emitter.motion.y;
+
+        // Integrate from the birth time to the end of the tick, following the emitter like the
+        // update kernel does for live particles
+        vec3 birthPosition = particle.position.xyz;
+        particle.position.xyz += particle.velocity.xyz * remainingTime + (emitter.position.xyz - birthLocation) * emitter.motion.x;
+        particle.velocity.w -= remainingTime;
+
+        storeParticle(gid, particle);
+        previousPositions[gid] = vec4(birthPosition, 1.0);
+        particleEmittersOut[gid] = emitterId;
+        aliveIndicesOut[atomicAdd(aliveCountAfterSimulation, 1)] = gid;
+    }
+}
@@ -0,0 +1,23 @@
+#ifndef TRAIL_GLSL
+#define TRAIL_GLSL
+
+// Per-particle position history for ribbons; see TrailSettings in ParticleSystem.h.
+// The length comes from ParticleSimulation::trailDefines().
+#ifndef TRAIL_LENGTH
+#define TRAIL_LENGTH 16
+#endif
+
+// TRAIL_LENGTH entries per particle slot, a ring indexed by tick: xyz = position (float bits)
+// at the start of that tick, w = the tick that wrote it. The stamp tells a particle's own
+// history apart from what an earlier occupant of the slot left behind.
+layout(std430, binding = 23) buffer TrailHistory
+{
+    uvec4 trailHistory[];
+};
+
+uint trailEntry(uint slot, uint tick)
+{
+    return slot * uint(TRAIL_LENGTH) + tick % uint(TRAIL_LENGTH);
+}
+
+#endif
@@ -1,36 +1,57 @@
 #version 460 core
 
+#include "emitter.glsl"
+#include "parameters.glsl"
+#include "particle_layout.glsl"
+
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec2 aTexCoord;
 
 out vec2 TexCoord;
 out vec4 ParticleColor;
+flat out vec3 SpriteRegion;   // xy = UV extent of the sheet in its layer, z = layer
 
-struct Particle {
-    vec4 position;   // xyz = position, w = size
-    vec4 color;      // rgba = color
-    vec4 velocity;   // xyz = velocity, w = lifetime
+// Alive slots written by the last update, one instance each
+layout(std430, binding = 2) readonly buffer AliveList
+{
+    uint aliveIndices[];
 };
 
-layout(std430, binding = 0) buffer ParticleBuffer 
+// Position before the latest tick, for render-time interpolation
+layout(std430, binding = 6) readonly buffer PreviousPositions
 {
-    Particle particles[];
+    vec4 previousPositions[];
 };
 
-uniform int currentFrame; //Flipbook frame
-
-//TODO: Change this to be a uniform
-uniform ivec2 gridSize; 
-uniform float maxLifetime;
+layout(std430, binding = 7) readonly buffer EmitterTable
+{
+    Emitter emitters[];
+};
 
-uniform mat4 viewProjMatrix;
-uniform mat4 viewMatrix;
+// Emitter id of every particle slot
+layout(std430, binding = 8) readonly buffer ParticleEmitters
+{
+    uint particleEmitters[];
+};
 
 void main() 
 {
-    Particle particle = particles[gl_InstanceID];
-    vec3 particlePos = particle.position.xyz;
-    float particleSize = particle.position.w;
+    uint particleIndex = aliveIndices[gl_InstanceID];
+    // Only the streams the billboard needs; velocity.xyz is never read here
+    vec4 particlePosition = loadParticlePosition(particleIndex);
+    vec3 particlePos = mix(previousPositions[particleIndex].xyz, particlePosition.xyz, interpolationAlpha);
+
+    // Flipbook layout comes from the particle's emitter
+    Emitter emitter = emitters[particleEmitters[particleIndex]];
+    ivec2 gridSize = emitter.gridSize.xy;
+    float maxLifetime = emitter.previousPosition.w;
+    float lifetime = loadParticleLifetime(particleIndex);
+
+#if PARTICLE_LAYOUT == PARTICLE_LAYOUT_PACKED
+    float particleSize = particleSizeForAge(lifetime, maxLifetime);
+#else
+    float particleSize = particlePosition.w;
+#endif
 
     // Billboard calculation
     vec3 cameraRight = vec3(viewMatrix[0][0], viewMatrix[1][0], viewMatrix[2][0]);
@@ -43,9 +64,6 @@ void main()
     
     // Sprite sheet animation calculation
     // Use particle lifetime to determine sprite frame
-    float lifetime = particle.velocity.w;
-
-    // Calculate sprite index based on lifetime
     int totalSprites = gridSize.x * gridSize.y;
     int currentSprite = int(mod(floor(lifetime / maxLifetime * float(totalSprites)), float(totalSprites)));
 
@@ -60,8 +78,9 @@ void main()
         (baseTex.x + float(spriteX)) / float(gridSize.y),
         (baseTex.y + float(spriteY)) / float(gridSize.x)
     );
+    SpriteRegion = emitter.textureRegion.xyz;
     
-    ParticleColor = particle.color;
+    ParticleColor = loadParticleColor(particleIndex);
 
     gl_Position = viewProjMatrix * vec4(vertexPosition, 1.0);
 }
\ No newline at end of file
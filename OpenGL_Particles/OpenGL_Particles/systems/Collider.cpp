@@ -0,0 +1,73 @@
+#include "Collider.h"
+
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    particle_simulation::ColliderData makeCollider(particle_simulation::ColliderShape shape, const particle_simulation::ColliderResponse& response)
+    {
+        particle_simulation::ColliderData collider = {};
+        collider.axisX = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+        collider.axisY = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+        collider.response = glm::vec4(response.restitution, response.friction, 0.0f, 0.0f);
+        collider.info = glm::uvec4(static_cast<GLuint>(shape), response.killOnContact ? 1u : 0u, 0u, 0u);
+
+        return collider;
+    }
+}
+
+particle_simulation::ColliderData particle_simulation::makePlaneCollider(const glm::vec3& normal, float offset, const ColliderResponse& response)
+{
+    ColliderData collider = makeCollider(ColliderShape::Plane, response);
+    collider.center = glm::vec4(glm::normalize(normal), offset);
+
+    // Planes are unbounded, so they are never culled
+    const float infinity = std::numeric_limits<float>::max();
+    collider.boundsMin = glm::vec4(-infinity);
+    collider.boundsMax = glm::vec4(infinity);
+
+    return collider;
+}
+
+particle_simulation::ColliderData particle_simulation::makeSphereCollider(const glm::vec3& center, float radius, const ColliderResponse& response)
+{
+    ColliderData collider = makeCollider(ColliderShape::Sphere, response);
+    collider.center = glm::vec4(center, radius);
+    collider.boundsMin = glm::vec4(center - glm::vec3(radius), 0.0f);
+    collider.boundsMax = glm::vec4(center + glm::vec3(radius), 0.0f);
+
+    return collider;
+}
+
+particle_simulation::ColliderData particle_simulation::makeCapsuleCollider(const glm::vec3& start, const glm::vec3& end, float radius, const ColliderResponse& response)
+{
+    ColliderData collider = makeCollider(ColliderShape::Capsule, response);
+    collider.center = glm::vec4(start, radius);
+    collider.extent = glm::vec4(end, 0.0f);
+    collider.boundsMin = glm::vec4(glm::min(start, end) - glm::vec3(radius), 0.0f);
+    collider.boundsMax = glm::vec4(glm::max(start, end) + glm::vec3(radius), 0.0f);
+
+    return collider;
+}
+
+particle_simulation::ColliderData particle_simulation::makeBoxCollider(const glm::vec3& center, const glm::vec3& halfExtents, const glm::mat3& rotation, const ColliderResponse& response)
+{
+    ColliderData collider = makeCollider(ColliderShape::Box, response);
+    collider.center = glm::vec4(center, 0.0f);
+    collider.extent = glm::vec4(halfExtents, 0.0f);
+    collider.axisX = glm::vec4(rotation[0], 0.0f);
+    collider.axisY = glm::vec4(rotation[1], 0.0f);
+
+    // Half extents of the rotated box along the world axes
+    glm::vec3 worldExtents(0.0f);
+    for (int axis = 0; axis < 3; axis++)
+    {
+        worldExtents += glm::abs(rotation[axis]) * halfExtents[axis];
+    }
+
+    collider.boundsMin = glm::vec4(center - worldExtents, 0.0f);
+    collider.boundsMax = glm::vec4(center + worldExtents, 0.0f);
+
+    return collider;
+}
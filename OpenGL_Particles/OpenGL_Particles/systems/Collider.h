@@ -0,0 +1,44 @@
+#pragma once
+
+#include "../glad/glad.h"
+#include <glm.hpp>
+
+namespace particle_simulation
+{
+    // Must match the COLLIDER_* values in collider.glsl
+    enum class ColliderShape : GLuint
+    {
+        Plane = 0,
+        Sphere = 1,
+        Capsule = 2,
+        Box = 3
+    };
+
+    // What happens to a particle that touches a collider
+    struct ColliderResponse
+    {
+        float restitution = 0.3f;   // fraction of the normal speed kept on bounce
+        float friction = 0.2f;      // fraction of the tangential speed lost on bounce
+        bool killOnContact = false; // release the particle instead of bouncing it
+    };
+
+    // Mirrors the Collider struct in collider.glsl (std430, 128 bytes)
+    struct ColliderData
+    {
+        glm::vec4 center;       // plane: xyz = normal, w = offset; others: xyz = center / capsule start, w = radius
+        glm::vec4 extent;       // capsule: xyz = segment end; box: xyz = half extents
+        glm::vec4 axisX;        // box orientation, world-space local axes
+        glm::vec4 axisY;
+        glm::vec4 response;     // x = restitution, y = friction
+        glm::uvec4 info;        // x = ColliderShape, y = kill on contact
+        glm::vec4 boundsMin;    // world AABB used to cull colliders per workgroup
+        glm::vec4 boundsMax;
+    };
+
+    // Points with dot(normal, p) < offset are inside
+    ColliderData makePlaneCollider(const glm::vec3& normal, float offset, const ColliderResponse& response = ColliderResponse());
+    ColliderData makeSphereCollider(const glm::vec3& center, float radius, const ColliderResponse& response = ColliderResponse());
+    ColliderData makeCapsuleCollider(const glm::vec3& start, const glm::vec3& end, float radius, const ColliderResponse& response = ColliderResponse());
+    // rotation maps the box's local axes to world space
+    ColliderData makeBoxCollider(const glm::vec3& center, const glm::vec3& halfExtents, const glm::mat3& rotation, const ColliderResponse& response = ColliderResponse());
+}
@@ -0,0 +1,149 @@
+#include "CurlNoise.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "ParticleRandom.h"
+
+namespace
+{
+    // Gradients on the edges of a cube, as in improved Perlin noise
+    const float latticeGradients[12][3] =
+    {
+        { 1, 1, 0 }, { -1, 1, 0 }, { 1, -1, 0 }, { -1, -1, 0 },
+        { 1, 0, 1 }, { -1, 0, 1 }, { 1, 0, -1 }, { -1, 0, -1 },
+        { 0, 1, 1 }, { 0, -1, 1 }, { 0, 1, -1 }, { 0, -1, -1 }
+    };
+
+    float fade(float t)
+    {
+        return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+    }
+
+    float lerp(float a, float b, float t)
+    {
+        return a + (b - a) * t;
+    }
+
+    int wrap(int value, int period)
+    {
+        return ((value % period) + period) % period;
+    }
+
+    // Gradient at a lattice corner, hashed with the same PCG4D the shaders use
+    float gradientDot(int x, int y, int z, uint32_t seed, float dx, float dy, float dz)
+    {
+        using namespace particle_simulation::random;
+        UInt4 hash = pcg4d({ static_cast<uint32_t>(x), static_cast<uint32_t>(y), static_cast<uint32_t>(z), seed });
+        const float* gradient = latticeGradients[hash.x % 12u];
+
+        return gradient[0] * dx + gradient[1] * dy + gradient[2] * dz;
+    }
+
+    // Gradient noise whose lattice repeats every period cells
+    float periodicNoise(float px, float py, float pz, int period, uint32_t seed)
+    {
+        const int x0 = static_cast<int>(std::floor(px));
+        const int y0 = static_cast<int>(std::floor(py));
+        const int z0 = static_cast<int>(std::floor(pz));
+
+        const float fx = px - x0;
+        const float fy = py - y0;
+        const float fz = pz - z0;
+
+        const int xi0 = wrap(x0, period), xi1 = wrap(x0 + 1, period);
+        const int yi0 = wrap(y0, period), yi1 = wrap(y0 + 1, period);
+        const int zi0 = wrap(z0, period), zi1 = wrap(z0 + 1, period);
+
+        const float u = fade(fx);
+        const float v = fade(fy);
+        const float w = fade(fz);
+
+        const float x00 = lerp(gradientDot(xi0, yi0, zi0, seed, fx, fy, fz), gradientDot(xi1, yi0, zi0, seed, fx - 1, fy, fz), u);
+        const float x10 = lerp(gradientDot(xi0, yi1, zi0, seed, fx, fy - 1, fz), gradientDot(xi1, yi1, zi0, seed, fx - 1, fy - 1, fz), u);
+        const float x01 = lerp(gradientDot(xi0, yi0, zi1, seed, fx, fy, fz - 1), gradientDot(xi1, yi0, zi1, seed, fx - 1, fy, fz - 1), u);
+        const float x11 = lerp(gradientDot(xi0, yi1, zi1, seed, fx, fy - 1, fz - 1), gradientDot(xi1, yi1, zi1, seed, fx - 1, fy - 1, fz - 1), u);
+
+        return lerp(lerp(x00, x10, v), lerp(x01, x11, v), w);
+    }
+}
+
+std::vector<glm::vec3> particle_simulation::bakeCurlNoise(const CurlNoiseSettings& settings)
+{
+    const int resolution = std::max(settings.resolution, 2);
+    const size_t voxelCount = static_cast<size_t>(resolution) * resolution * resolution;
+
+    auto voxelIndex = [resolution](int x, int y, int z)
+    {
+        return (static_cast<size_t>(wrap(z, resolution)) * resolution + wrap(y, resolution)) * resolution + wrap(x, resolution);
+    };
+
+    // Three decorrelated fBm channels of a vector potential
+    std::vector<float> potential[3];
+    for (int channel = 0; channel < 3; channel++)
+    {
+        potential[channel].resize(voxelCount);
+
+        for (int z = 0; z < resolution; z++)
+        {
+            for (int y = 0; y < resolution; y++)
+            {
+                for (int x = 0; x < resolution; x++)
+                {
+                    float value = 0.0f;
+                    float amplitude = 1.0f;
+                    int period = std::max(settings.period, 1);
+
+                    for (int octave = 0; octave < settings.octaves; octave++)
+                    {
+                        const float cellsPerVoxel = static_cast<float>(period) / resolution;
+                        const uint32_t seed = settings.seed + channel * 1013u + octave * 7919u;
+
+                        value += amplitude * periodicNoise(x * cellsPerVoxel, y * cellsPerVoxel, z * cellsPerVoxel, period, seed);
+
+                        amplitude *= settings.persistence;
+                        period *= 2;
+                    }
+
+                    potential[channel][voxelIndex(x, y, z)] = value;
+                }
+            }
+        }
+    }
+
+    // Curl by central differences with wrap-around, so the result tiles as well
+    std::vector<glm::vec3> field(voxelCount);
+    float maxLength = 0.0f;
+
+    for (int z = 0; z < resolution; z++)
+    {
+        for (int y = 0; y < resolution; y++)
+        {
+            for (int x = 0; x < resolution; x++)
+            {
+                auto derivative = [&](int channel, int dx, int dy, int dz)
+                {
+                    return 0.5f * (potential[channel][voxelIndex(x + dx, y + dy, z + dz)] -
+                        potential[channel][voxelIndex(x - dx, y - dy, z - dz)]);
+                };
+
+                const float curlX = derivative(2, 0, 1, 0) - derivative(1, 0, 0, 1);
+                const float curlY = derivative(0, 0, 0, 1) - derivative(2, 1, 0, 0);
+                const float curlZ = derivative(1, 1, 0, 0) - derivative(0, 0, 1, 0);
+
+                field[voxelIndex(x, y, z)] = glm::vec3(curlX, curlY, curlZ);
+                maxLength = std::max(maxLength, std::sqrt(curlX * curlX + curlY * curlY + curlZ * curlZ));
+            }
+        }
+    }
+
+    if (maxLength > 0.0f)
+    {
+        for (glm::vec3& velocity : field)
+        {
+            velocity /= maxLength;
+        }
+    }
+
+    return field;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm.hpp>
+
+namespace particle_simulation
+{
+    struct CurlNoiseSettings
+    {
+        int resolution = 64;        // voxels along each axis
+        int period = 4;             // noise lattice cells across the volume at the first octave
+        int octaves = 3;            // each octave doubles the frequency; all of them tile
+        float persistence = 0.5f;   // amplitude falloff per octave
+        uint32_t seed = 1u;
+    };
+
+    // How the update kernel samples the baked volume
+    struct TurbulenceSettings
+    {
+        CurlNoiseSettings noise;
+        float scale = 0.3f;                                   // volume repeats every 1 / scale world units
+        glm::vec3 scroll = glm::vec3(0.0f, -0.1f, 0.02f);    // volume units per second
+        float strength = 1.5f;                                // world units per second at peak velocity
+    };
+
+    // Bakes a tileable, divergence-free velocity field: the curl of a three-channel
+    // periodic gradient-noise potential. Voxels are x-fastest and the peak length is 1.
+    std::vector<glm::vec3> bakeCurlNoise(const CurlNoiseSettings& settings);
+}
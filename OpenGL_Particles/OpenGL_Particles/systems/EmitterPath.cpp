@@ -0,0 +1,103 @@
+#include "EmitterPath.h"
+
+particle_simulation::EmitterPath particle_simulation::makeSwayPath(const glm::vec3& amplitude, float frequency, float phase)
+{
+    EmitterPath path;
+    path.type = EmitterPathType::Sway;
+    path.vector = amplitude;
+    path.frequency = frequency;
+    path.phase = phase;
+
+    return path;
+}
+
+particle_simulation::EmitterPath particle_simulation::makeOrbitPath(const glm::vec3& axis, float radius, float angularSpeed, float phase)
+{
+    EmitterPath path;
+    path.type = EmitterPathType::Orbit;
+    path.vector = glm::normalize(axis);
+    path.frequency = angularSpeed;
+    path.radius = radius;
+    path.phase = phase;
+
+    return path;
+}
+
+particle_simulation::EmitterPath particle_simulation::makeLinearPath(const std::vector<EmitterPathKey>& keys, bool bLoop)
+{
+    EmitterPath path;
+    path.type = EmitterPathType::Linear;
+    path.keys = keys;
+    path.bLoop = bLoop;
+
+    return path;
+}
+
+particle_simulation::EmitterPath particle_simulation::makeSplinePath(const std::vector<EmitterPathKey>& keys, bool bLoop)
+{
+    EmitterPath path = makeLinearPath(keys, bLoop);
+    path.type = EmitterPathType::Spline;
+
+    return path;
+}
+
+void particle_simulation::expandEmitterPathBounds(const EmitterPath& path, const glm::vec3& location, glm::vec3& boundsMin, glm::vec3& boundsMax)
+{
+    auto expand = [&](const glm::vec3& point)
+    {
+        boundsMin = glm::min(boundsMin, point);
+        boundsMax = glm::max(boundsMax, point);
+    };
+
+    switch (path.type)
+    {
+    case EmitterPathType::Sway:
+        expand(location - glm::abs(path.vector));
+        expand(location + glm::abs(path.vector));
+        break;
+    case EmitterPathType::Orbit:
+        expand(location - glm::vec3(path.radius));
+        expand(location + glm::vec3(path.radius));
+        break;
+    case EmitterPathType::Linear:
+    case EmitterPathType::Spline:
+        for (const EmitterPathKey& key : path.keys)
+        {
+            expand(location + key.position);
+        }
+        break;
+    default:
+        break;
+    }
+
+    expand(location);
+}
+
+particle_simulation::EmitterPathData particle_simulation::packEmitterPath(const EmitterPath& path, const glm::vec3& location,
+    std::vector<EmitterPathKey>& keyTable)
+{
+    EmitterPathType type = path.type;
+    const bool bKeyed = type == EmitterPathType::Linear || type == EmitterPathType::Spline;
+
+    // A keyed path without keys stays where it is
+    if (bKeyed && path.keys.empty())
+    {
+        type = EmitterPathType::Static;
+    }
+
+    EmitterPathData data = {};
+    data.origin = glm::vec4(location, path.radius);
+    data.vector = glm::vec4(path.vector, path.frequency);
+    data.params = glm::vec4(path.phase, 0.0f, 0.0f, 0.0f);
+    data.info = glm::uvec4(static_cast<GLuint>(type), 0u, 0u, path.bLoop ? 1u : 0u);
+
+    if (type == EmitterPathType::Linear || type == EmitterPathType::Spline)
+    {
+        data.params.y = path.keys.back().time - path.keys.front().time;
+        data.info.y = static_cast<GLuint>(keyTable.size());
+        data.info.z = static_cast<GLuint>(path.keys.size());
+        keyTable.insert(keyTable.end(), path.keys.begin(), path.keys.end());
+    }
+
+    return data;
+}
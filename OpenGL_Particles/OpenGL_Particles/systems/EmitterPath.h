@@ -0,0 +1,61 @@
+#pragma once
+
+#include "../glad/glad.h"
+#include <glm.hpp>
+#include <vector>
+
+namespace particle_simulation
+{
+    // Must match the PATH_* values in emitter_motion.glsl
+    enum class EmitterPathType : GLuint
+    {
+        Static = 0,
+        Sway = 1,       // location + amplitude * sin(frequency * t + phase)
+        Orbit = 2,      // circle of radius around location, in the plane normal to the axis
+        Linear = 3,     // straight segments between keys
+        Spline = 4      // Catmull-Rom curve through the keys
+    };
+
+    // A point the emitter passes through, relative to its location
+    struct EmitterPathKey
+    {
+        glm::vec3 position = glm::vec3(0.0f);
+        float time = 0.0f;      // seconds; keys must be in ascending time order
+    };
+
+    static_assert(sizeof(EmitterPathKey) == 16, "EmitterPathKey must match the std430 vec4 in emitter_motion.glsl");
+
+    // Trajectory of an emitter as a function of simulation time. The GPU evaluates it every
+    // tick, so moving emitters cost no CPU time or uploads.
+    struct EmitterPath
+    {
+        EmitterPathType type = EmitterPathType::Static;
+        glm::vec3 vector = glm::vec3(0.0f);     // sway: amplitude; orbit: axis
+        float frequency = 0.0f;                 // radians per second
+        float radius = 0.0f;                    // orbit radius
+        float phase = 0.0f;                     // radians
+        std::vector<EmitterPathKey> keys;       // linear and spline paths
+        bool bLoop = true;                      // keyed paths repeat after the last key, or stop on it
+    };
+
+    EmitterPath makeSwayPath(const glm::vec3& amplitude, float frequency, float phase = 0.0f);
+    EmitterPath makeOrbitPath(const glm::vec3& axis, float radius, float angularSpeed, float phase = 0.0f);
+    // A looping path should repeat its first key at the end to close up
+    EmitterPath makeLinearPath(const std::vector<EmitterPathKey>& keys, bool bLoop = true);
+    EmitterPath makeSplinePath(const std::vector<EmitterPathKey>& keys, bool bLoop = true);
+
+    // Mirrors the EmitterPath struct in emitter_motion.glsl (std430, 64 bytes)
+    struct EmitterPathData
+    {
+        glm::vec4 origin;       // xyz = emitter location, w = orbit radius
+        glm::vec4 vector;       // xyz = sway amplitude or orbit axis, w = frequency
+        glm::vec4 params;       // x = phase, y = duration of the keys
+        glm::uvec4 info;        // x = EmitterPathType, y = first key, z = key count, w = loop
+    };
+
+    // Grows the box to hold every point of the path; spline overshoot between keys is not included
+    void expandEmitterPathBounds(const EmitterPath& path, const glm::vec3& location, glm::vec3& boundsMin, glm::vec3& boundsMax);
+
+    // Appends the path's keys to the shared key table and returns its row of the path table
+    EmitterPathData packEmitterPath(const EmitterPath& path, const glm::vec3& location, std::vector<EmitterPathKey>& keyTable);
+}
@@ -0,0 +1,51 @@
+#include "ForceField.h"
+
+#include <limits>
+
+namespace
+{
+    particle_simulation::ForceData makeForce(particle_simulation::ForceType type, const glm::vec3& vector, float strength,
+        const particle_simulation::ForceVolume& volume)
+    {
+        particle_simulation::ForceData force = {};
+        force.position = glm::vec4(volume.center, volume.radius);
+        force.vector = glm::vec4(vector, 0.0f);
+        force.params = glm::vec4(strength, 0.0f, 0.0f, 0.0f);
+        force.info = glm::uvec4(static_cast<GLuint>(type), static_cast<GLuint>(volume.falloff), 0u, 0u);
+
+        // Unbounded forces are never culled
+        const float extent = volume.radius > 0.0f ? volume.radius : std::numeric_limits<float>::max();
+        force.boundsMin = volume.radius > 0.0f ? glm::vec4(volume.center - glm::vec3(extent), 0.0f) : glm::vec4(-extent);
+        force.boundsMax = volume.radius > 0.0f ? glm::vec4(volume.center + glm::vec3(extent), 0.0f) : glm::vec4(extent);
+
+        return force;
+    }
+}
+
+particle_simulation::ForceData particle_simulation::makeAttractorForce(float strength, const ForceVolume& volume)
+{
+    return makeForce(ForceType::Attractor, glm::vec3(0.0f), strength, volume);
+}
+
+particle_simulation::ForceData particle_simulation::makeVortexForce(const glm::vec3& axis, float strength, float inwardPull, const ForceVolume& volume)
+{
+    ForceData force = makeForce(ForceType::Vortex, glm::normalize(axis), strength, volume);
+    force.params.y = inwardPull;
+
+    return force;
+}
+
+particle_simulation::ForceData particle_simulation::makeWindForce(const glm::vec3& direction, float strength, const ForceVolume& volume)
+{
+    return makeForce(ForceType::Wind, glm::normalize(direction), strength, volume);
+}
+
+particle_simulation::ForceData particle_simulation::makeDragForce(const glm::vec3& coefficients, float strength, const ForceVolume& volume)
+{
+    return makeForce(ForceType::Drag, coefficients, strength, volume);
+}
+
+particle_simulation::ForceData particle_simulation::makeGravityForce(const glm::vec3& acceleration, const ForceVolume& volume)
+{
+    return makeForce(ForceType::Gravity, acceleration, 1.0f, volume);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "../glad/glad.h"
+#include <glm.hpp>
+
+namespace particle_simulation
+{
+    // Must match the FORCE_* values in force.glsl
+    enum class ForceType : GLuint
+    {
+        Attractor = 0,
+        Vortex = 1,
+        Wind = 2,
+        Drag = 3,
+        Gravity = 4
+    };
+
+    // How a force weakens from its centre to the edge of its influence volume
+    enum class ForceFalloff : GLuint
+    {
+        None = 0,       // full strength up to the edge
+        Linear = 1,
+        Smooth = 2,     // (1 - t^2)^2
+        InverseSquare = 3   // 1 / (1 + 24 t^2), windowed to reach 0 at the edge
+    };
+
+    // Sphere a force acts in; a radius of 0 means everywhere
+    struct ForceVolume
+    {
+        glm::vec3 center = glm::vec3(0.0f);
+        float radius = 0.0f;
+        ForceFalloff falloff = ForceFalloff::Smooth;
+    };
+
+    // Mirrors the Force struct in force.glsl (std430, 96 bytes)
+    struct ForceData
+    {
+        glm::vec4 position;     // xyz = influence centre, w = influence radius (0 = unbounded)
+        glm::vec4 vector;       // vortex: axis; wind: direction; drag: per-axis coefficients; gravity: acceleration
+        glm::vec4 params;       // x = strength, y = vortex inward pull
+        glm::uvec4 info;        // x = ForceType, y = ForceFalloff
+        glm::vec4 boundsMin;    // world AABB used to cull forces per workgroup
+        glm::vec4 boundsMax;
+    };
+
+    // Pulls towards the centre; a negative strength pushes away
+    ForceData makeAttractorForce(float strength, const ForceVolume& volume);
+    // Swirls around the axis through the volume centre, optionally pulling inwards
+    ForceData makeVortexForce(const glm::vec3& axis, float strength, float inwardPull, const ForceVolume& volume);
+    ForceData makeWindForce(const glm::vec3& direction, float strength, const ForceVolume& volume = ForceVolume());
+    // Removes coefficients * strength of the velocity per second, per axis
+    ForceData makeDragForce(const glm::vec3& coefficients, float strength, const ForceVolume& volume = ForceVolume());
+    ForceData makeGravityForce(const glm::vec3& acceleration, const ForceVolume& volume = ForceVolume());
+}
@@ -0,0 +1,166 @@
+#include "FrameBudgetGovernor.h"
+
+#include <algorithm>
+
+#include "ParticleSystem.h"
+
+particle_simulation::FrameBudgetGovernor::FrameBudgetGovernor(const FrameBudgetSettings& settings) :
+    settings(settings),
+    queries{},
+    queryFrame(0),
+    framesIssued(0),
+    averageMilliseconds(0.0f),
+    bMeasured(false),
+    secondsSinceAdjust(0.0),
+    settleSeconds(0.0f),
+    reduction(0.0f)
+{
+}
+
+particle_simulation::FrameBudgetGovernor::~FrameBudgetGovernor()
+{
+    cleanup();
+}
+
+void particle_simulation::FrameBudgetGovernor::addSystem(ParticleSimulation* simulation, int priority, float minQualityScale)
+{
+    GovernedSystem system = { simulation, priority, std::clamp(minQualityScale, 0.0f, 1.0f) };
+
+    // Kept sorted so the reduction walks from the least important system up
+    auto position = std::upper_bound(systems.begin(), systems.end(), priority,
+        [](int value, const GovernedSystem& other) { return value < other.priority; });
+    systems.insert(position, system);
+
+    applyReduction();
+}
+
+void particle_simulation::FrameBudgetGovernor::update(double deltaTime)
+{
+    if (queries[0][0] == 0)
+    {
+        glGenQueries(queryFrames * 2, &queries[0][0]);
+    }
+
+    secondsSinceAdjust += deltaTime;
+
+    glBeginQuery(GL_TIME_ELAPSED, queries[queryFrame][0]);
+    for (const GovernedSystem& system : systems)
+    {
+        system.simulation->update(deltaTime);
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+}
+
+void particle_simulation::FrameBudgetGovernor::render(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix)
+{
+    if (queries[0][0] == 0)
+    {
+        return;
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, queries[queryFrame][1]);
+    for (const GovernedSystem& system : systems)
+    {
+        system.simulation->render(viewMatrix, projectionMatrix);
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+
+    queryFrame = (queryFrame + 1) % queryFrames;
+    framesIssued++;
+
+    readTimings();
+}
+
+float particle_simulation::FrameBudgetGovernor::getAverageMilliseconds() const
+{
+    return averageMilliseconds;
+}
+
+void particle_simulation::FrameBudgetGovernor::cleanup()
+{
+    if (queries[0][0] != 0)
+    {
+        glDeleteQueries(queryFrames * 2, &queries[0][0]);
+        queries[0][0] = 0;
+    }
+}
+
+void particle_simulation::FrameBudgetGovernor::readTimings()
+{
+    // The next frame's queries were issued queryFrames - 1 frames ago; read them before reuse
+    if (framesIssued < queryFrames)
+    {
+        return;
+    }
+
+    const GLuint* frame = queries[queryFrame];
+    GLint updateAvailable = 0;
+    GLint renderAvailable = 0;
+    glGetQueryObjectiv(frame[0], GL_QUERY_RESULT_AVAILABLE, &updateAvailable);
+    glGetQueryObjectiv(frame[1], GL_QUERY_RESULT_AVAILABLE, &renderAvailable);
+
+    // Still in flight, the sample is dropped rather than waited for
+    if (!updateAvailable || !renderAvailable)
+    {
+        return;
+    }
+
+    GLuint64 updateNanoseconds = 0;
+    GLuint64 renderNanoseconds = 0;
+    glGetQueryObjectui64v(frame[0], GL_QUERY_RESULT, &updateNanoseconds);
+    glGetQueryObjectui64v(frame[1], GL_QUERY_RESULT, &renderNanoseconds);
+
+    const float milliseconds = static_cast<float>((updateNanoseconds + renderNanoseconds) * 1.0e-6);
+    averageMilliseconds = bMeasured ? averageMilliseconds + (milliseconds - averageMilliseconds) * settings.smoothing : milliseconds;
+    bMeasured = true;
+
+    adjust();
+}
+
+void particle_simulation::FrameBudgetGovernor::adjust()
+{
+    if (secondsSinceAdjust < std::max(settleSeconds, settings.minSettleSeconds))
+    {
+        return;
+    }
+
+    float maxReduction = 0.0f;
+    for (const GovernedSystem& system : systems)
+    {
+        maxReduction += 1.0f - system.minQualityScale;
+    }
+
+    // Between the restore threshold and the budget nothing changes, so the scale can't oscillate
+    const float previous = reduction;
+    if (averageMilliseconds > settings.budgetMilliseconds)
+    {
+        reduction = std::min(reduction + settings.shrinkStep, maxReduction);
+    }
+    else if (averageMilliseconds < settings.budgetMilliseconds * settings.restoreThreshold)
+    {
+        reduction = std::max(reduction - settings.restoreStep, 0.0f);
+    }
+
+    if (reduction != previous)
+    {
+        settleSeconds = applyReduction();
+        secondsSinceAdjust = 0.0;
+    }
+}
+
+float particle_simulation::FrameBudgetGovernor::applyReduction()
+{
+    float remaining = reduction;
+    float maxLifetime = 0.0f;
+    for (const GovernedSystem& system : systems)
+    {
+        const float taken = std::min(remaining, 1.0f - system.minQualityScale);
+        if (system.simulation->getQualityScale() != 1.0f - taken)
+        {
+            system.simulation->setQualityScale(1.0f - taken);
+            maxLifetime = std::max(maxLifetime, system.simulation->getMaxParticleLifetime());
+        }
+        remaining -= taken;
+    }
+    return maxLifetime;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vector>
+#include "../glad/glad.h"
+#include <glm.hpp>
+
+namespace particle_simulation
+{
+    class ParticleSimulation;
+
+    struct FrameBudgetSettings
+    {
+        float budgetMilliseconds = 2.0f;    // GPU time for every particle update and draw in a frame
+        float restoreThreshold = 0.8f;      // share of the budget under which quality comes back
+        float shrinkStep = 0.1f;            // quality taken per adjustment while over budget
+        float restoreStep = 0.02f;          // quality given back per adjustment while under the threshold
+        float minSettleSeconds = 0.5f;      // least wait between adjustments, for the average to catch up
+        float smoothing = 0.1f;             // weight of the newest frame in the running average
+    };
+
+    // Keeps the particle GPU time under a budget by scaling spawn rates: the lowest priority
+    // systems give way first and get their rate back last once there is headroom.
+    // Timings come from a ring of timer queries read a few frames late, so nothing stalls.
+    // A rate change only shows fully once the particles spawned before it have died, so after
+    // each adjustment the governor waits out the longest lifetime of the systems it changed.
+    class FrameBudgetGovernor
+    {
+    public:
+        explicit FrameBudgetGovernor(const FrameBudgetSettings& settings = FrameBudgetSettings());
+        ~FrameBudgetGovernor();
+
+        // minQualityScale is the least share of its spawn rate a system keeps; 1 never reduces it
+        void addSystem(ParticleSimulation* simulation, int priority, float minQualityScale = 0.1f);
+
+        // Update and render every system, each pass inside one timer query. Call once per frame each.
+        void update(double deltaTime);
+        void render(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix);
+
+        float getAverageMilliseconds() const;
+
+        void cleanup();
+
+    private:
+        struct GovernedSystem
+        {
+            ParticleSimulation* simulation;
+            int priority;
+            float minQualityScale;
+        };
+
+        // Frames a timing waits before it is read
+        static constexpr int queryFrames = 4;
+
+        void readTimings();
+        void adjust();
+
+        // Returns the longest particle lifetime among the systems whose scale changed
+        float applyReduction();
+
+        FrameBudgetSettings settings;
+        std::vector<GovernedSystem> systems;    // lowest priority first
+
+        // [frame][0] = update pass, [frame][1] = render pass
+        GLuint queries[queryFrames][2];
+        int queryFrame;
+        int framesIssued;
+
+        float averageMilliseconds;
+        bool bMeasured;
+        double secondsSinceAdjust;
+        float settleSeconds;
+
+        // Quality taken away in total, spent from the lowest priority system up
+        float reduction;
+    };
+}
@@ -0,0 +1,202 @@
+#include "InputRecording.h"
+
+#include <iostream>
+
+namespace
+{
+    constexpr char recordingMagic[4] = { 'P', 'R', 'E', 'C' };
+    // 2: vector-field transforms, depth collision, heightfield and turbulence are recorded
+    constexpr uint32_t recordingVersion = 2;
+}
+
+particle_simulation::InputRecording::InputRecording() :
+    inputSize(0),
+    bStarted(false)
+{
+}
+
+bool particle_simulation::InputRecording::startRecording(const std::string& path)
+{
+    stop();
+
+    output.open(path, std::ios::binary | std::ios::trunc);
+    if (!output.is_open())
+    {
+        std::cerr << "Failed to open " << path << " for recording" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool particle_simulation::InputRecording::startReplay(const std::string& path)
+{
+    stop();
+
+    input.open(path, std::ios::binary | std::ios::ate);
+    if (!input.is_open())
+    {
+        std::cerr << "Failed to open recording " << path << std::endl;
+        return false;
+    }
+
+    inputSize = input.tellg();
+    input.seekg(0);
+
+    return true;
+}
+
+void particle_simulation::InputRecording::stop()
+{
+    if (output.is_open())
+    {
+        output.close();
+    }
+    if (input.is_open())
+    {
+        input.close();
+    }
+    bStarted = false;
+}
+
+void particle_simulation::InputRecording::begin(std::vector<uint32_t>& seeds)
+{
+    if (output.is_open())
+    {
+        output.write(recordingMagic, sizeof(recordingMagic));
+        write(recordingVersion);
+        write(static_cast<uint32_t>(seeds.size()));
+        output.write(reinterpret_cast<const char*>(seeds.data()), seeds.size() * sizeof(uint32_t));
+        bStarted = true;
+    }
+    else if (input.is_open())
+    {
+        char magic[4] = {};
+        input.read(magic, sizeof(magic));
+        const uint32_t version = read<uint32_t>();
+        const uint32_t count = read<uint32_t>();
+
+        if (!input || std::char_traits<char>::compare(magic, recordingMagic, sizeof(magic)) != 0 || version != recordingVersion)
+        {
+            std::cerr << "Not a particle input recording, or one from another version" << std::endl;
+            stop();
+            return;
+        }
+        if (count != seeds.size())
+        {
+            std::cerr << "Recording has " << count << " emitters, the simulation " << seeds.size() << std::endl;
+            stop();
+            return;
+        }
+
+        input.read(reinterpret_cast<char*>(seeds.data()), count * sizeof(uint32_t));
+        bStarted = true;
+    }
+}
+
+bool particle_simulation::InputRecording::nextEvent(InputEvent& event)
+{
+    if (!isReplaying())
+    {
+        return false;
+    }
+
+    read(event);
+    if (!input)
+    {
+        stop();
+        return false;
+    }
+
+    return true;
+}
+
+bool particle_simulation::InputRecording::readComplete()
+{
+    if (input)
+    {
+        return true;
+    }
+
+    if (isReplaying())
+    {
+        std::cerr << "Recording ends inside an event; replay stopped" << std::endl;
+        stop();
+    }
+    return false;
+}
+
+bool particle_simulation::InputRecording::fits(uint32_t count, size_t elementSize)
+{
+    const std::streamoff position = input.tellg();
+    if (position < 0 || static_cast<uint64_t>(count) * elementSize > static_cast<uint64_t>(inputSize - position))
+    {
+        input.setstate(std::ios::failbit);
+        return false;
+    }
+    return true;
+}
+
+void particle_simulation::InputRecording::write(const EmissionSettings& emission)
+{
+    write(emission.spawnRate);
+    write(static_cast<int32_t>(emission.maxSpawnPerTick));
+    write(static_cast<uint32_t>(emission.bursts.size()));
+    for (const EmissionBurst& burst : emission.bursts)
+    {
+        write(burst);
+    }
+}
+
+void particle_simulation::InputRecording::write(const EmitterPath& path)
+{
+    write(path.type);
+    write(path.vector);
+    write(path.frequency);
+    write(path.radius);
+    write(path.phase);
+    write(static_cast<uint8_t>(path.bLoop));
+    write(static_cast<uint32_t>(path.keys.size()));
+    for (const EmitterPathKey& key : path.keys)
+    {
+        write(key);
+    }
+}
+
+void particle_simulation::InputRecording::read(EmissionSettings& emission)
+{
+    read(emission.spawnRate);
+    emission.maxSpawnPerTick = read<int32_t>();
+    const uint32_t burstCount = read<uint32_t>();
+    if (!fits(burstCount, sizeof(EmissionBurst)))
+    {
+        return;
+    }
+
+    emission.bursts.resize(burstCount);
+    for (EmissionBurst& burst : emission.bursts)
+    {
+        read(burst);
+    }
+}
+
+void particle_simulation::InputRecording::read(EmitterPath& path)
+{
+    read(path.type);
+    read(path.vector);
+    read(path.frequency);
+    read(path.radius);
+    read(path.phase);
+    path.bLoop = read<uint8_t>() != 0;
+    const uint32_t keyCount = read<uint32_t>();
+    if (!fits(keyCount, sizeof(EmitterPathKey)))
+    {
+        return;
+    }
+
+    path.keys.resize(keyCount);
+    for (EmitterPathKey& key : path.keys)
+    {
+        read(key);
+    }
+}
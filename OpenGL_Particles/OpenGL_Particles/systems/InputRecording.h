@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <glm.hpp>
+
+#include "EmitterPath.h"
+#include "ParticleEmitter.h"
+
+namespace particle_simulation
+{
+    // Calls that change a simulation after init(), in the order they were made
+    enum class InputEvent : uint8_t
+    {
+        Update = 0,         // double deltaTime
+        Render = 1,         // mat4 view, mat4 projection
+        Emission = 2,       // int32 emitter, EmissionSettings
+        EmitterPath = 3,    // int32 emitter, EmitterPath
+        DestroyEmitter = 4, // int32 emitter
+        Paused = 5,         // uint8 paused
+        TimeScale = 6,      // float scale
+        StepTick = 7,
+        TickRate = 8,       // double ticks per second, int32 max substeps
+        AddCollider = 9,    // ColliderData
+        SetCollider = 10,   // int32 collider, ColliderData
+        ClearColliders = 11,
+        AddForce = 12,      // ForceData
+        SetForce = 13,      // int32 force, ForceData
+        ClearForces = 14,
+        QualityScale = 15,  // float scale
+        VectorFieldTransform = 16,  // int32 field, mat4 transform
+        DepthCollision = 17,        // mat4 view, mat4 projection, DepthCollisionSettings
+        Heightfield = 18,           // vec3 origin, vec2 size, float scale, ColliderResponse
+        Turbulence = 19             // TurbulenceSettings
+    };
+
+    // Binary log of one simulation's inputs: a header with the emitter RNG seeds, then one
+    // event byte and its payload per call. Values are stored in the machine's own byte order,
+    // so a recording replays on the platform that made it.
+    class InputRecording
+    {
+    public:
+        InputRecording();
+
+        // Open the file; nothing is written or read until begin()
+        bool startRecording(const std::string& path);
+        bool startReplay(const std::string& path);
+        void stop();
+
+        // Writes the header when recording; when replaying, replaces the seeds with the recorded
+        // ones, or stops if the recording has a different emitter count
+        void begin(std::vector<uint32_t>& seeds);
+
+        bool isRecording() const { return bStarted && output.is_open(); }
+        bool isReplaying() const { return bStarted && input.is_open(); }
+
+        template <typename... Args>
+        void record(InputEvent event, const Args&... args)
+        {
+            if (!isRecording())
+            {
+                return;
+            }
+
+            write(event);
+            (write(args), ...);
+        }
+
+        // False, and replay stops, at the end of the recording
+        bool nextEvent(InputEvent& event);
+
+        // False, and replay stops, if the reads since nextEvent ran past the end of the recording
+        // or a count in them was larger than the rest of the file could hold
+        bool readComplete();
+
+        template <typename T>
+        T read()
+        {
+            T value{};
+            read(value);
+            return value;
+        }
+
+    private:
+        template <typename T>
+        void write(const T& value)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "Only plain values are written directly");
+            output.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        void write(const EmissionSettings& emission);
+        void write(const EmitterPath& path);
+
+        template <typename T>
+        void read(T& value)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "Only plain values are read directly");
+            input.read(reinterpret_cast<char*>(&value), sizeof(T));
+        }
+
+        void read(EmissionSettings& emission);
+        void read(EmitterPath& path);
+
+        // Whether count elements could still follow in the file; checked before allocating for them
+        bool fits(uint32_t count, size_t elementSize);
+
+        std::ofstream output;
+        std::ifstream input;
+        std::streamoff inputSize;
+        bool bStarted;
+    };
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm.hpp>
+
+#include "EmitterPath.h"
+
+namespace particle_simulation
+{
+    // A one-shot (or repeating) burst of particles on top of the continuous rate
+    struct EmissionBurst
+    {
+        float time = 0.0f;        // seconds after the emitter starts
+        int count = 0;            // particles spawned per cycle
+        int cycles = 1;           // 0 = repeat forever
+        float interval = 0.0f;    // seconds between cycles
+    };
+
+    struct EmissionSettings
+    {
+        float spawnRate = 0.0f;       // particles per second
+        int maxSpawnPerTick = 0;      // per fixed simulation tick, so several per frame at high tick rates; 0 = unlimited
+        std::vector<EmissionBurst> bursts;
+    };
+
+    // Everything that distinguishes one effect from another in a shared particle pool
+    struct EmitterSettings
+    {
+        glm::vec3 location = glm::vec3(0.0f);
+
+        // Motion around location, evaluated on the GPU from the simulation time
+        EmitterPath path;
+
+        // Share of the emitter's motion its live particles follow: 1 moves them with the emitter,
+        // 0 leaves them where they were born so a moving emitter draws a trail
+        float followEmitter = 1.0f;
+        // Share of the emitter's velocity new particles start with
+        float inheritVelocity = 0.0f;
+
+        float sphereRadius = 1.0f;
+        float maxParticleLifetime = 1.0f;
+
+        // Flipbook sprite sheet
+        std::string texturePath;
+        glm::ivec2 gridSize = glm::ivec2(1, 1);
+
+        EmissionSettings emission;
+    };
+
+    // CPU side of an emitter: turns elapsed time into a spawn count for the spawn kernel.
+    // Its motion is evaluated on the GPU by emitter_motion.glsl.
+    class ParticleEmitter
+    {
+    public:
+        ParticleEmitter(const EmitterSettings& settings, uint32_t seed);
+
+        void setEmission(const EmissionSettings& emission);
+        void setPath(const EmitterPath& path);
+        const EmitterSettings& getSettings() const { return settings; }
+
+        void reset();
+
+        // Advances the emitter clock by one tick and returns how many particles to spawn in it;
+        // rateScale thins out both the continuous rate and the bursts. tickCount is how many
+        // fixed ticks deltaTime stands for: a coarse fast-forward tick gets their whole budget.
+        int emit(double deltaTime, float rateScale = 1.0f, double tickCount = 1.0);
+
+        uint32_t getSeed() const { return seed; }
+        void setSeed(uint32_t newSeed) { seed = newSeed; }
+
+        // A destroyed emitter stops spawning; its particles fade out and return to the pool
+        void destroy() { bAlive = false; }
+        bool isAlive() const { return bAlive; }
+
+    private:
+        int countBurstsInRange(const EmissionBurst& burst, double startTime, double endTime) const;
+
+        EmitterSettings settings;
+        uint32_t seed;
+        bool bAlive;
+
+        double emitterTime;
+        double spawnAccumulator;
+    };
+}
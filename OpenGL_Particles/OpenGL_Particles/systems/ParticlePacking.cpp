@@ -0,0 +1,63 @@
+#include "ParticlePacking.h"
+
+#include <cmath>
+#include <cstring>
+#include <glm.hpp>
+
+#include "ParticleRandom.h"
+
+namespace
+{
+    uint32_t floatBits(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+}
+
+uint32_t particle_simulation::packHalfStochastic(float value, float noise)
+{
+    const uint32_t nearest = glm::packHalf2x16(glm::vec2(value, 0.0f)) & 0xFFFFu;
+    const float rounded = glm::unpackHalf2x16(nearest).x;
+    if (rounded == value || std::isnan(value))
+    {
+        return nearest;
+    }
+
+    // Halves are sign-magnitude, so the other neighbour is one step up or down in magnitude
+    const uint32_t other = std::abs(value) > std::abs(rounded) ? nearest + 1u : nearest - 1u;
+    const float otherRounded = glm::unpackHalf2x16(other).x;
+
+    return noise < (value - rounded) / (otherRounded - rounded) ? other : nearest;
+}
+
+particle_simulation::PackedParticle particle_simulation::packParticle(const Particle& particle, uint32_t slot)
+{
+    using namespace random;
+
+    // Dither keyed by the slot and the new position, so it changes every tick
+    const UInt4 noiseBits = pcg4d({ slot, floatBits(particle.position.x), floatBits(particle.position.y), floatBits(particle.position.z) });
+    const Float4 noise = rngToUnitFloat4(noiseBits);
+    const Float4 colorNoise = rngToUnitFloat4(pcg4d(noiseBits));
+
+    PackedParticle packed;
+    packed.position = glm::vec3(particle.position);
+    packed.velocityXY = packHalfStochastic(particle.velocity.x, noise.x) | (packHalfStochastic(particle.velocity.y, noise.y) << 16u);
+    packed.velocityZLifetime = packHalfStochastic(particle.velocity.z, noise.z) | (packHalfStochastic(particle.velocity.w, noise.w) << 16u);
+    packed.color = glm::packUnorm4x8(particle.color +
+        glm::vec4(colorNoise.x - 0.5f, colorNoise.y - 0.5f, colorNoise.z - 0.5f, colorNoise.w - 0.5f) / 255.0f);
+    return packed;
+}
+
+particle_simulation::Particle particle_simulation::unpackParticle(const PackedParticle& packed)
+{
+    const glm::vec2 velocityXY = glm::unpackHalf2x16(packed.velocityXY);
+    const glm::vec2 velocityZLifetime = glm::unpackHalf2x16(packed.velocityZLifetime);
+
+    Particle particle;
+    particle.position = glm::vec4(packed.position, 0.0f);
+    particle.color = glm::unpackUnorm4x8(packed.color);
+    particle.velocity = glm::vec4(velocityXY.x, velocityXY.y, velocityZLifetime.x, velocityZLifetime.y);
+    return particle;
+}
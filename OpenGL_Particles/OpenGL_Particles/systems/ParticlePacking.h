@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include "../glad/glad.h"
+#include <glm.hpp>
+
+namespace particle_simulation
+{
+    struct Particle
+    {
+        glm::vec4 position;   // xyz = position, w = size
+        glm::vec4 color;      // rgba = color
+        glm::vec4 velocity;   // xyz = velocity, w = lifetime
+    };
+
+    // Mirrors PackedParticle in particle_layout.glsl (std430, 24 bytes): half-float velocity
+    // and lifetime, unorm8 color. Size is derived from the age instead of stored.
+    struct PackedParticle
+    {
+        glm::vec3 position;
+        GLuint velocityXY;          // half2
+        GLuint velocityZLifetime;   // half2
+        GLuint color;               // unorm8 x 4
+    };
+
+    static_assert(sizeof(PackedParticle) == 24, "PackedParticle must match the std430 layout");
+
+    // Same as packHalfStochastic in particle_layout.glsl: one of the two nearest halves, with
+    // odds by distance, so increments below half a ulp survive on average. noise is in [0, 1).
+    uint32_t packHalfStochastic(float value, float noise);
+
+    // Same encoding and dither as storeParticle in particle_layout.glsl, so a particle packed
+    // here matches the one the shader stores in that slot. Unpacking leaves the size at 0.
+    PackedParticle packParticle(const Particle& particle, uint32_t slot);
+    Particle unpackParticle(const PackedParticle& packed);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+// Bit-exact CPU twin of shaders/random.glsl. Integer draws and the [0, 1) floats
+// match the GPU exactly; rngPointInSphere uses transcendental functions, so it
+// only matches to within float precision. tests/RandomTests.cpp holds reference
+// hashes and a uniformity check.
+namespace particle_simulation::random
+{
+    struct UInt4
+    {
+        uint32_t x, y, z, w;
+    };
+
+    struct Float4
+    {
+        float x, y, z, w;
+    };
+
+    struct Rng
+    {
+        UInt4 key;   // x = spawn index within the tick, y = frame, z = emitter seed, w = draw counter
+    };
+
+    // PCG4D hash (Jarzynski & Olano, "Hash Functions for GPU Rendering", 2020)
+    inline UInt4 pcg4d(UInt4 v)
+    {
+        v.x = v.x * 1664525u + 1013904223u;
+        v.y = v.y * 1664525u + 1013904223u;
+        v.z = v.z * 1664525u + 1013904223u;
+        v.w = v.w * 1664525u + 1013904223u;
+
+        v.x += v.y * v.w;
+        v.y += v.z * v.x;
+        v.z += v.x * v.y;
+        v.w += v.y * v.z;
+
+        v.x ^= v.x >> 16u;
+        v.y ^= v.y >> 16u;
+        v.z ^= v.z >> 16u;
+        v.w ^= v.w >> 16u;
+
+        v.x += v.y * v.w;
+        v.y += v.z * v.x;
+        v.z += v.x * v.y;
+        v.w += v.y * v.z;
+
+        return v;
+    }
+
+    inline Rng rngCreate(uint32_t spawnIndex, uint32_t frame, uint32_t seed)
+    {
+        return Rng{ { spawnIndex, frame, seed, 0u } };
+    }
+
+    inline UInt4 rngNextUint4(Rng& rng)
+    {
+        UInt4 bits = pcg4d(rng.key);
+        rng.key.w++;
+        return bits;
+    }
+
+    inline float rngToUnitFloat(uint32_t bits)
+    {
+        return static_cast<float>(bits >> 8u) * (1.0f / 16777216.0f);
+    }
+
+    inline Float4 rngToUnitFloat4(UInt4 bits)
+    {
+        return { rngToUnitFloat(bits.x), rngToUnitFloat(bits.y), rngToUnitFloat(bits.z), rngToUnitFloat(bits.w) };
+    }
+
+    inline Float4 rngNextFloat4(Rng& rng)
+    {
+        return rngToUnitFloat4(rngNextUint4(rng));
+    }
+
+    // Uniform point inside a ball of the given radius from three unit floats
+    inline void rngPointInSphere(float ux, float uy, float uz, float radius, float& outX, float& outY, float& outZ)
+    {
+        float theta = ux * 6.28318530718f;
+        float cosPhi = 2.0f * uy - 1.0f;
+        float sinPhi = std::sqrt(std::fmax(0.0f, 1.0f - cosPhi * cosPhi));
+        float r = radius * std::pow(uz, 1.0f / 3.0f);
+
+        outX = r * sinPhi * std::cos(theta);
+        outY = r * sinPhi * std::sin(theta);
+        outZ = r * cosPhi;
+    }
+}
@@ -1,47 +1,131 @@
 // smoke_simulation.cpp
 #include "ParticleSystem.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <iostream>
+#include <limits>
+#include <numeric>
+#include <sstream>
 #include <GLFW/glfw3.h>
 
 #include "stb_image.h"
 #include "../utilities/ShaderUtils.h"
 #include "../Config.h"
 
-particle_simulation::ParticleSimulation::ParticleSimulation(
-    int maxParticles,
-    const glm::vec3& emitterLocation,
-    int totalFrames,
-    glm::ivec2 gridSize,
-    float frameRate,
-    float maxParticleLifetime,
-    float sphereRadius,
-    const std::string& texturePath) :
+namespace
+{
+    // Uniforms outside the SimulationParameters block, hashed at compile time
+    constexpr ShaderUtils::UniformName workGroupSizeUniform("workGroupSize");
+    constexpr ShaderUtils::UniformName ribbonStripVerticesUniform("ribbonStripVertices");
+
+    // Handles are zeroed once deleted, so cleanup() can run again (destroy() then the destructor)
+    void deleteBuffer(GLuint& buffer)
+    {
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+
+    void deleteTexture(GLuint& texture)
+    {
+        glDeleteTextures(1, &texture);
+        texture = 0;
+    }
+
+    void deleteVertexArray(GLuint& vertexArray)
+    {
+        glDeleteVertexArrays(1, &vertexArray);
+        vertexArray = 0;
+    }
+
+    // Conservative: a box straddling a plane counts as inside
+    bool boxInFrustum(const glm::mat4& viewProjection, const glm::vec3& boxMin, const glm::vec3& boxMax)
+    {
+        // Clip planes in world space, from the rows of the view-projection matrix
+        const glm::mat4& m = viewProjection;
+        const glm::vec4 rowX(m[0][0], m[1][0], m[2][0], m[3][0]);
+        const glm::vec4 rowY(m[0][1], m[1][1], m[2][1], m[3][1]);
+        const glm::vec4 rowZ(m[0][2], m[1][2], m[2][2], m[3][2]);
+        const glm::vec4 rowW(m[0][3], m[1][3], m[2][3], m[3][3]);
+        const glm::vec4 planes[6] = { rowW + rowX, rowW - rowX, rowW + rowY, rowW - rowY, rowW + rowZ, rowW - rowZ };
+
+        for (const glm::vec4& plane : planes)
+        {
+            // The corner furthest along the plane normal
+            const glm::vec3 corner(plane.x >= 0.0f ? boxMax.x : boxMin.x, plane.y >= 0.0f ? boxMax.y : boxMin.y,
+                plane.z >= 0.0f ? boxMax.z : boxMin.z);
+            if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+particle_simulation::ParticleSimulation::ParticleSimulation(int maxParticles, ParticleLayout layout) :
     maxParticles(maxParticles),
-    particleBuffer(0),
+    layout(layout),
+    currentStateSet(0),
+    renderStateSet(0),
+    deadListBuffer(0),
+    counterBuffer(0),
+    emitterBuffer(0),
     renderVAO(0),
     billboardVBO(0),
     renderProgram(0),
-    computeProgram(0), smokeTexture(0),
-    viewProjMatrixLocation(0),
-    deltaTimeLocation(0),
-    viewMatrixLocation(0), texturePath(texturePath),
-    gridSize(gridSize),
-    frameRate(frameRate),
-    maxParticleLifetime(maxParticleLifetime),
-    sphereRadius(sphereRadius),
-    totalFrames(totalFrames)
+    computeProgram(0),
+    indirectArgsProgram(0),
+    spawnProgram(0),
+    emitterMotionProgram(0),
+    trailHistoryBuffer(0),
+    ribbonProgram(0),
+    ribbonVAO(0),
+    emitterPathBuffer(0),
+    emitterPathKeyBuffer(0),
+    emitterSpawnCountBuffer(0),
+    spriteSheetArray(0),
+    turbulenceField(0),
+    depthCollisionTexture(0),
+    colliderBuffer(0),
+    colliderBufferSize(0),
+    forceBuffer(0),
+    forceBufferSize(0),
+    heightfieldTexture(0)
 {
     rng = std::mt19937(static_cast<unsigned int>(time(nullptr)));
     dist = std::uniform_real_distribution<float>(-1.0f, 1.0f);
-    currentEmitterLocation = emitterLocation;
-    previousEmitterLocation = glm::vec3(0.0f);
-    bPause = true;
+    frameIndex = 0;
 
-    // frameRate = 60.0f;
-    // maxParticleLifetime = 5.00f;
-    // totalFrames = 25;
-    // gridSize = glm::ivec2(5, 5);
+    tickRate = 60.0;
+    maxSubsteps = 4;
+    tickAccumulator = 0.0;
+    simulationTime = 0.0;
+    interpolationAlpha = 0.0f;
+    bDensityRepulsion = false;
+    bTrails = false;
+    depthViewProjection = glm::mat4(1.0f);
+    depthCameraPosition = glm::vec3(0.0f);
+    depthTexelSize = glm::vec2(0.0f);
+    bCollidersDirty = false;
+    bForcesDirty = false;
+    heightfieldOrigin = glm::vec3(0.0f);
+    heightfieldSize = glm::vec2(1.0f);
+    heightfieldScale = 1.0f;
+    bPause = false;
+    timeScale = 1.0f;
+    pendingSteps = 0;
+    qualityScale = 1.0f;
+    bSleepEnabled = false;
+    boundsMin = glm::vec3(0.0f);
+    boundsMax = glm::vec3(0.0f);
+    lastViewProjection = glm::mat4(1.0f);
+    bRendered = false;
+    framesOutOfView = 0;
+    sleptTime = 0.0;
+    bApplyingReplay = false;
 }
 
 particle_simulation::ParticleSimulation::~ParticleSimulation()
@@ -49,21 +133,104 @@ particle_simulation::ParticleSimulation::~ParticleSimulation()
     cleanup();
 }
 
+int particle_simulation::ParticleSimulation::addEmitter(const EmitterSettings& settings)
+{
+    emitters.emplace_back(settings, static_cast<uint32_t>(rng()));
+    return static_cast<int>(emitters.size()) - 1;
+}
+
+int particle_simulation::ParticleSimulation::addVectorField(const VectorFieldSettings& settings)
+{
+    if (static_cast<int>(vectorFieldSettings.size()) >= maxVectorFields)
+    {
+        std::cerr << "Ignoring vector field " << settings.path << ": at most " << maxVectorFields << " are supported" << std::endl;
+        return -1;
+    }
+
+    vectorFieldSettings.push_back(settings);
+    return static_cast<int>(vectorFieldSettings.size()) - 1;
+}
+
 void particle_simulation::ParticleSimulation::init()
 {
+    // From here on every input is recorded or replayed; a replay brings back the recorded seeds
+    std::vector<uint32_t> seeds;
+    for (const ParticleEmitter& emitter : emitters)
+    {
+        seeds.push_back(emitter.getSeed());
+    }
+    recording.begin(seeds);
+    for (size_t i = 0; i < emitters.size(); i++)
+    {
+        emitters[i].setSeed(seeds[i]);
+    }
+
     // Create and compile shaders
-    renderProgram = ShaderUtils::loadShader(std::string(SHADER_PATH) + "/vertex.glsl", std::string(SHADER_PATH) + "/fragment.glsl");
-    computeProgram = ShaderUtils::loadComputeShader(std::string(SHADER_PATH) + "/compute.glsl");
+    renderProgram = ShaderUtils::loadShader(std::string(SHADER_PATH) + "/vertex.glsl", std::string(SHADER_PATH) + "/fragment.glsl", layoutDefines());
+    indirectArgsProgram = ShaderUtils::loadComputeShader(std::string(SHADER_PATH) + "/indirect_args.glsl");
+    spawnProgram = ShaderUtils::loadComputeShader(std::string(SHADER_PATH) + "/spawn.glsl", layoutDefines());
+    emitterMotionProgram = ShaderUtils::loadComputeShader(std::string(SHADER_PATH) + "/emitter_motion.glsl");
+    parameters.init(parameterBlockBinding);
+
+    // Two state sets, each with the particles, the positions before the tick that wrote them
+    // (for render-time interpolation), the owning emitter of each slot, the alive list and
+    // the indirect dispatch/draw arguments derived from it
+    auto createStorage = [](GLuint& buffer, GLsizeiptr size)
+    {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    };
+
+    for (ParticleStateSet& stateSet : stateSets)
+    {
+        createStorage(stateSet.particleBuffer, particleBufferSize(maxParticles));
+        createStorage(stateSet.previousPositionBuffer, maxParticles * sizeof(glm::vec4));
+        createStorage(stateSet.particleEmitterBuffer, maxParticles * sizeof(GLuint));
+        createStorage(stateSet.aliveListBuffer, maxParticles * sizeof(GLuint));
+        createStorage(stateSet.indirectBuffer, sizeof(IndirectArgs));
+    }
+
+    // The dead list and atomic counters
+    createStorage(deadListBuffer, maxParticles * sizeof(GLuint));
+    createStorage(counterBuffer, sizeof(ParticleCounters));
+
+    // Emitter table, written once; the GPU moves the emitters and the CPU only uploads spawn counts
+    createStorage(emitterBuffer, std::max<size_t>(emitters.size(), 1) * sizeof(EmitterData));
+    createStorage(emitterSpawnCountBuffer, std::max<size_t>(emitters.size(), 1) * sizeof(GLuint));
+    emitterSpawnCounts.assign(emitters.size(), 0u);
+
+    // Trail history; createParticles() stamps it empty
+    if (bTrails)
+    {
+        createStorage(trailHistoryBuffer, static_cast<GLsizeiptr>(maxParticles) * trails.length * sizeof(glm::uvec4));
+        ribbonProgram = ShaderUtils::loadShader(std::string(SHADER_PATH) + "/ribbon_vertex.glsl", std::string(SHADER_PATH) + "/ribbon_fragment.glsl",
+            layoutDefines() + trailDefines());
+    }
+
+    // Sprite sheets are needed to fill in the emitter table
+    createSpriteSheets();
+    createEmitterPaths();
+    if (bSleepEnabled)
+    {
+        updateBounds();
+    }
 
-    // Get uniform locations
-    viewProjMatrixLocation = glGetUniformLocation(renderProgram, "viewProjMatrix");
-    viewMatrixLocation = glGetUniformLocation(renderProgram, "viewMatrix");
-    deltaTimeLocation = glGetUniformLocation(computeProgram, "deltaTime");
+    // Bake the turbulence volume, fill in the parameters and upload the colliders and forces
+    // first so the autotuner times the real configuration
+    createTurbulenceField();
+    createVectorFields();
+    writeTurbulenceParameters();
+    writeVectorFieldParameters();
+    writeDensityParameters();
+    writeDepthCollisionParameters();
+    writeHeightfieldParameters();
+    writeTrailParameters();
+    uploadColliders();
+    uploadForces();
 
-    // Create particles SSBO
-    glGenBuffers(1, &particleBuffer);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, particleBuffer);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, maxParticles * sizeof(Particle), nullptr, GL_DYNAMIC_DRAW);
+    // Build the update kernel variant that runs fastest on this driver
+    selectUpdateKernel();
 
     // Initialize particles
     createParticles();
@@ -90,164 +257,1612 @@ void particle_simulation::ParticleSimulation::init()
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
 
-    // Load smoke texture
-    glGenTextures(1, &smokeTexture);
-    glBindTexture(GL_TEXTURE_2D, smokeTexture);
+    // Ribbons are built from gl_VertexID alone, so their VAO has no attributes
+    if (bTrails)
+    {
+        glGenVertexArrays(1, &ribbonVAO);
+    }
+
+    // Start at steady state: births spread across the lifetime range instead of one burst on the first tick
+    if (prewarm.duration > 0.0f)
+    {
+        fastForward(prewarm.duration, prewarm.steps, false);
+    }
+}
+
+void particle_simulation::ParticleSimulation::createSpriteSheets()
+{
+    struct SpriteSheetImage
+    {
+        unsigned char* data;
+        int width;
+        int height;
+    };
+
+    // Emitters sharing a sprite sheet share a layer
+    std::vector<SpriteSheetImage> images;
+    std::vector<int> emitterLayers;
+    int maxWidth = 1;
+    int maxHeight = 1;
+
+    for (const ParticleEmitter& emitter : emitters)
+    {
+        const std::string& texturePath = emitter.getSettings().texturePath;
+        auto existing = std::find(spriteSheetPaths.begin(), spriteSheetPaths.end(), texturePath);
+        if (existing != spriteSheetPaths.end())
+        {
+            emitterLayers.push_back(static_cast<int>(existing - spriteSheetPaths.begin()));
+            continue;
+        }
+
+        SpriteSheetImage image = { nullptr, 1, 1 };
+        int channels;
+        image.data = stbi_load((std::string(RESOURCE_PATH) + "/" + texturePath).c_str(), &image.width, &image.height, &channels, 4);
+        if (!image.data)
+        {
+            std::cerr << "Failed to load sprite sheet " << texturePath << std::endl;
+            image.width = 1;
+            image.height = 1;
+        }
+
+        maxWidth = std::max(maxWidth, image.width);
+        maxHeight = std::max(maxHeight, image.height);
+
+        emitterLayers.push_back(static_cast<int>(spriteSheetPaths.size()));
+        spriteSheetPaths.push_back(texturePath);
+        images.push_back(image);
+    }
+
+    // Sheets of different sizes sit in the corner of a layer sized for the largest one
+    glGenTextures(1, &spriteSheetArray);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, spriteSheetArray);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, maxWidth, maxHeight, std::max<GLsizei>(static_cast<GLsizei>(images.size()), 1), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    for (size_t layer = 0; layer < images.size(); layer++)
+    {
+        const SpriteSheetImage& image = images[layer];
+        if (image.data)
+        {
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<GLint>(layer), image.width, image.height, 1, GL_RGBA, GL_UNSIGNED_BYTE, image.data);
+            stbi_image_free(image.data);
+        }
+
+        spriteSheetRegions.emplace_back(static_cast<float>(image.width) / maxWidth, static_cast<float>(image.height) / maxHeight);
+    }
+
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
 
-    int width, height, channels;
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    if (unsigned char* data = stbi_load(
-        (std::string(RESOURCE_PATH) + "/" + texturePath).c_str(),
-        &width,
-        &height,
-        &channels,
-        0))
+    // Static part of the emitter table; positions and spawn counts are filled in every tick
+    emitterData.resize(emitters.size());
+    for (size_t i = 0; i < emitters.size(); i++)
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        stbi_image_free(data);
+        const EmitterSettings& settings = emitters[i].getSettings();
+        const int layer = emitterLayers[i];
+
+        emitterData[i].position = glm::vec4(settings.location, settings.sphereRadius);
+        emitterData[i].previousPosition = glm::vec4(settings.location, settings.maxParticleLifetime);
+        emitterData[i].textureRegion = glm::vec4(spriteSheetRegions[layer], static_cast<float>(layer), 0.0f);
+        emitterData[i].gridSize = glm::ivec4(settings.gridSize, 0, 0);
+        emitterData[i].state = glm::uvec4(0u, emitters[i].getSeed(), 1u, 0u);
+        emitterData[i].motion = glm::vec4(settings.followEmitter, settings.inheritVelocity, 0.0f, 0.0f);
     }
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, emitterBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, emitterData.size() * sizeof(EmitterData), emitterData.data());
 }
 
-void particle_simulation::ParticleSimulation::createParticles()
+void particle_simulation::ParticleSimulation::createEmitterPaths()
 {
-    std::vector<Particle> particles(maxParticles);
+    std::vector<EmitterPathData> paths;
+    std::vector<EmitterPathKey> keys;
+    for (const ParticleEmitter& emitter : emitters)
+    {
+        paths.push_back(packEmitterPath(emitter.getSettings().path, emitter.getSettings().location, keys));
+    }
 
-    glUseProgram(renderProgram);
-    ShaderUtils::setUniformIVec2(renderProgram, "gridSize", gridSize);
-    ShaderUtils::setUniformFloat(renderProgram, "maxLifetime", maxParticleLifetime);
-    
-    glUseProgram(computeProgram);
-    ShaderUtils::setUniformVec3(computeProgram, "particleEmitterOrigin", currentEmitterLocation);
-    ShaderUtils::setUniformFloat(computeProgram, "maxLifetime", maxParticleLifetime);
-    ShaderUtils::setUniformFloat(computeProgram, "sphereRadius", sphereRadius);
-    
-    for (int i = 0; i < maxParticles; i++)
+    // Sized to the emitters exactly: the motion kernel takes the emitter count from the length
+    if (emitterPathBuffer == 0)
     {
-        particles[i].velocity = glm::vec4(0.0f);
+        glGenBuffers(1, &emitterPathBuffer);
+        glGenBuffers(1, &emitterPathKeyBuffer);
     }
 
-    ShaderUtils::setUniformInt(computeProgram, "emitterAlive", 1);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, particleBuffer);
-    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, maxParticles * sizeof(Particle), particles.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, emitterPathBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(paths.size(), 1) * sizeof(EmitterPathData), paths.empty() ? nullptr : paths.data(), GL_STATIC_DRAW);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, emitterPathKeyBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(keys.size(), 1) * sizeof(EmitterPathKey), keys.empty() ? nullptr : keys.data(), GL_STATIC_DRAW);
 }
 
-void particle_simulation::ParticleSimulation::update(double deltaTime)
+std::string particle_simulation::ParticleSimulation::updateKernelFeatureDefines() const
 {
-    glUseProgram(computeProgram);
-    ShaderUtils::setUniformFloat(computeProgram, "deltaTime", deltaTime);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleBuffer);
+    std::string defines;
+    if (bDensityRepulsion)
+    {
+        defines += "#define USE_SPATIAL_GRID 1\n" + spatialGrid.defines();
+    }
+    if (bTrails)
+    {
+        defines += "#define USE_TRAILS 1\n" + trailDefines();
+    }
+    return defines;
+}
+
+void particle_simulation::ParticleSimulation::selectUpdateKernel()
+{
+    // Each feature combination is a different kernel with its own best variant; the key is one
+    // line of the cache file, so the defines go in as "NAME value" pairs
+    std::string cacheKey = KernelAutotuner::driverKey() + "|compute.glsl|" + particleLayoutName(layout);
+    std::istringstream featureLines(updateKernelFeatureDefines());
+    std::string featureLine;
+    while (std::getline(featureLines, featureLine))
+    {
+        cacheKey += "|" + featureLine.substr(featureLine.find(' ') + 1);
+    }
 
-    // Add ping-pong movement using sine function
-    float timeElapsed = static_cast<float>(glfwGetTime());
-    float amplitude = 3.0f; 
-    float frequency = 0.5f;
+    // The collider and force loops are timed too, so a scene with more of them tunes again
+    cacheKey += "|colliders " + std::to_string(colliders.size()) + "|forces " + std::to_string(forces.size());
 
-    // Ping-pong effect along the x-axis
-    currentEmitterLocation.x = amplitude * sin(frequency * timeElapsed);
+    if (!KernelAutotuner::loadCached(KERNEL_CACHE_PATH, cacheKey, updateKernelVariant))
+    {
+        // The untuned default is not worth remembering
+        if (autotuneUpdateKernel())
+        {
+            KernelAutotuner::storeCached(KERNEL_CACHE_PATH, cacheKey, updateKernelVariant);
+        }
+    }
 
-    ShaderUtils::setUniformVec3(computeProgram, "particleEmitterCurrentPos", currentEmitterLocation);
-    ShaderUtils::setUniformVec3(computeProgram, "prevParticleEmitterPos", previousEmitterLocation);
+    std::cout << "Update kernel: local_size_x = " << updateKernelVariant.workGroupSize
+        << (updateKernelVariant.sharedStaging ? ", shared staging" : "") << std::endl;
 
-    previousEmitterLocation = currentEmitterLocation;
+    // The grid is built with the update kernel's indirect arguments, so it shares its workgroup size
+    if (bDensityRepulsion)
+    {
+        spatialGrid.init(maxParticles, updateKernelVariant.workGroupSize, layoutDefines());
+    }
 
-    int workGroupSize = 512;
-    int numGroups = (maxParticles + workGroupSize - 1) / workGroupSize;
-    glDispatchCompute(numGroups, 1, 1);
-    
-    //Debug
-    // if (Particle* particles = static_cast<Particle*>(glMapBuffer(GL_SHADER_STORAGE_BUFFER, GL_READ_ONLY | GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT)))
-    // {
-    //     for (int i = 0; i < 2; ++i)
-    //     {
-    //
-    //         std::cout << "Position: "
-    //         << particles[i].position.x << ", "
-    //         << particles[i].position.y << ", "
-    //         << particles[i].position.z << std::endl;
-    //     
-    //         std::cout << "  Color: "
-    //                   << particles[i].color.r << ", "
-    //                   << particles[i].color.g << ", "
-    //                   << particles[i].color.b << ", "
-    //                   << particles[i].color.a << std::endl;
-    //
-    //         std::cout << "  Velocity: "
-    //                   << particles[i].velocity.x << ", "
-    //                   << particles[i].velocity.y << ", "
-    //                   << particles[i].velocity.z << ", Lifetime: "
-    //                   << particles[i].velocity.w << std::endl;
-    //
-    //         std::cout << "------------------------------------" << std::endl;
-    //     }
-    //
-    //     // Unmap after reading
-    //     glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
-    // }
-    // else
-    // {
-    //     std::cerr << "Failed to map buffer!" << std::endl;
-    // }   
+    computeProgram = ShaderUtils::loadComputeShader(std::string(SHADER_PATH) + "/compute.glsl",
+        updateKernelVariant.defines() + layoutDefines() + updateKernelFeatureDefines());
 }
 
-void particle_simulation::ParticleSimulation::beginBlend()
+bool particle_simulation::ParticleSimulation::autotuneUpdateKernel()
 {
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glDepthMask(GL_FALSE);
+    if (emitters.empty())
+    {
+        return false;
+    }
+
+    const int particleCount = bTrails ?
+        static_cast<int>(std::min<size_t>(autotuneParticles, autotuneTrailBytes / (trails.length * sizeof(glm::uvec4)))) : autotuneParticles;
+
+    // Synthetic workload: every particle alive and owned by emitter 0, so each variant runs the full update path
+    std::vector<Particle> particles(particleCount);
+    std::vector<GLuint> indices(particleCount);
+    std::iota(indices.begin(), indices.end(), 0u);
+
+    for (int i = 0; i < particleCount; i++)
+    {
+        particles[i].position = glm::vec4(0.0f, static_cast<float>(i % 1024) * 0.01f, 0.0f, 1.0f);
+        particles[i].color = glm::vec4(0.9f);
+        particles[i].velocity = glm::vec4(0.0f, 0.5f, 0.0f, 1.0e6f);
+    }
+
+    std::vector<GLuint> emitterIds(particleCount, 0u);
+
+    GLuint benchmarkBuffers[11];
+    glGenBuffers(11, benchmarkBuffers);
+
+    auto createBenchmarkBuffer = [](GLuint buffer, GLuint bindingPoint, GLsizeiptr size, const void* data)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, size, data, GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bindingPoint, buffer);
+    };
+
+    createBenchmarkBuffer(benchmarkBuffers[0], binding::particles, particleBufferSize(particleCount), nullptr);
+    uploadParticles(benchmarkBuffers[0], particles);
+    bindParticleStreams(benchmarkBuffers[0], particleCount, stream::all);
+    createBenchmarkBuffer(benchmarkBuffers[1], binding::deadList, particleCount * sizeof(GLuint), nullptr);
+    createBenchmarkBuffer(benchmarkBuffers[2], binding::aliveListIn, particleCount * sizeof(GLuint), indices.data());
+    createBenchmarkBuffer(benchmarkBuffers[3], binding::aliveListOut, particleCount * sizeof(GLuint), nullptr);
+    createBenchmarkBuffer(benchmarkBuffers[4], binding::previousPositions, particleCount * sizeof(glm::vec4), nullptr);
+    createBenchmarkBuffer(benchmarkBuffers[5], binding::particleEmitters, particleCount * sizeof(GLuint), emitterIds.data());
+    createBenchmarkBuffer(benchmarkBuffers[6], binding::particlesOut, particleBufferSize(particleCount), nullptr);
+    bindParticleStreams(benchmarkBuffers[6], particleCount, stream::all, true);
+    createBenchmarkBuffer(benchmarkBuffers[7], binding::particleEmittersOut, particleCount * sizeof(GLuint), nullptr);
+
+    // The feature buffers the real kernel reads and writes: an empty grid, so density queries look
+    // up their cells but find no neighbours, and a trail history for the synthetic pool
+    if (bDensityRepulsion)
+    {
+        const GLuint zero = 0;
+        createBenchmarkBuffer(benchmarkBuffers[8], binding::gridCells, spatialGrid.getCellCount() * sizeof(glm::uvec2), nullptr);
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+        createBenchmarkBuffer(benchmarkBuffers[9], binding::gridSortedParticles, sizeof(glm::uvec4), nullptr);
+    }
+    if (bTrails)
+    {
+        createBenchmarkBuffer(benchmarkBuffers[10], binding::trailHistory,
+            static_cast<GLsizeiptr>(particleCount) * trails.length * sizeof(glm::uvec4), nullptr);
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::counters, counterBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::emitters, emitterBuffer);
+
+    // The scene's colliders, forces and textures, uploaded by init(), so the collider and force
+    // loops and the workgroup culling that stages them in shared memory run as they will in play
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::colliders, colliderBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::forces, forceBuffer);
+    bindUpdateTextures();
+
+    parameters.edit().deltaTime = 1.0f / 60.0f;
+    parameters.upload();
+    parameters.bind();
+
+    const std::vector<KernelAutotuner::KernelVariant> variants =
+        KernelAutotuner::buildVariantMatrix({ 64, 128, 256, 512, 1024 }, sizeof(Particle), cullingSharedBytes);
+
+    updateKernelVariant = KernelAutotuner::tune(variants,
+        [this](const KernelAutotuner::KernelVariant& variant)
+        {
+            return ShaderUtils::loadComputeShader(std::string(SHADER_PATH) + "/compute.glsl",
+                variant.defines() + layoutDefines() + updateKernelFeatureDefines());
+        },
+        [particleCount](GLuint program, const KernelAutotuner::KernelVariant& variant)
+        {
+            glUseProgram(program);
+            glDispatchCompute((particleCount + variant.workGroupSize - 1) / variant.workGroupSize, 1, 1);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        },
+        [this, particleCount]()
+        {
+            // Reset the lists so every run simulates the whole pool
+            ParticleCounters counters = { static_cast<GLuint>(particleCount), 0, 0, 0 };
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(ParticleCounters), &counters);
+        });
+
+    glDeleteBuffers(11, benchmarkBuffers);
+    return true;
 }
 
-void particle_simulation::ParticleSimulation::endBlend()
+void particle_simulation::ParticleSimulation::bindUpdateTextures() const
 {
-    glDepthMask(GL_TRUE);
-    glDisable(GL_BLEND);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_3D, turbulenceField);
+    for (size_t i = 0; i < vectorFieldTextures.size(); i++)
+    {
+        glActiveTexture(GL_TEXTURE1 + static_cast<GLenum>(i));
+        glBindTexture(GL_TEXTURE_3D, vectorFieldTextures[i]);
+    }
+    if (depthCollisionTexture != 0)
+    {
+        glActiveTexture(GL_TEXTURE5);
+        glBindTexture(GL_TEXTURE_2D, depthCollisionTexture);
+    }
+    if (heightfieldTexture != 0)
+    {
+        glActiveTexture(GL_TEXTURE6);
+        glBindTexture(GL_TEXTURE_2D, heightfieldTexture);
+    }
 }
 
-void particle_simulation::ParticleSimulation::render(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix)
+void particle_simulation::ParticleSimulation::createTurbulenceField()
 {
-    glm::mat4 viewProjMatrix = projectionMatrix * viewMatrix;
+    const int resolution = std::max(turbulence.noise.resolution, 2);
+    const std::vector<glm::vec3> field = bakeCurlNoise(turbulence.noise);
 
-    glUseProgram(renderProgram);
-    ShaderUtils::setUniformMat4(renderProgram, "viewProjMatrix", viewProjMatrix);
-    ShaderUtils::setUniformMat4(renderProgram, "viewMatrix", viewMatrix);
-    
-    float time = glfwGetTime();
-    int currentFrame = static_cast<int>(time * frameRate) % totalFrames;
-    ShaderUtils::setUniformInt(renderProgram, "currentFrame", currentFrame);
+    if (turbulenceField == 0)
+    {
+        glGenTextures(1, &turbulenceField);
+    }
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, smokeTexture);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleBuffer);
+    // The bake tiles, so repeat wrapping hides the seams
+    glBindTexture(GL_TEXTURE_3D, turbulenceField);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB16F, resolution, resolution, resolution, 0, GL_RGB, GL_FLOAT, field.data());
 
-    glBindVertexArray(renderVAO);
-    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, maxParticles);
-    
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 }
 
-void particle_simulation::ParticleSimulation::PauseSim()
+void particle_simulation::ParticleSimulation::writeTurbulenceParameters()
 {
-    //TODO: Change this
-    bPause = !bPause;
+    SimulationParameters& block = parameters.edit();
+    block.turbulenceScale = turbulence.scale;
+    block.turbulenceScroll = turbulence.scroll;
+    block.turbulenceStrength = turbulence.strength;
 }
 
-void particle_simulation::ParticleSimulation::cleanup()
+void particle_simulation::ParticleSimulation::createVectorFields()
+{
+    vectorFieldTextures.resize(vectorFieldSettings.size());
+    vectorFieldLocalToVolumes.resize(vectorFieldSettings.size());
+    glGenTextures(static_cast<GLsizei>(vectorFieldTextures.size()), vectorFieldTextures.data());
+
+    for (size_t i = 0; i < vectorFieldSettings.size(); i++)
+    {
+        // A field that fails to load becomes a single zero vector so the ids stay stable
+        VectorFieldVolume volume;
+        if (!loadVectorField(vectorFieldSettings[i], volume))
+        {
+            volume.resolution = glm::ivec3(1);
+            volume.vectors.assign(1, glm::vec3(0.0f));
+        }
+
+        vectorFieldLocalToVolumes[i] = vectorFieldLocalToVolume(volume);
+
+        glBindTexture(GL_TEXTURE_3D, vectorFieldTextures[i]);
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB16F, volume.resolution.x, volume.resolution.y, volume.resolution.z, 0, GL_RGB, GL_FLOAT, volume.vectors.data());
+
+        // The kernel ignores particles outside the bounds, so edges just clamp
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+}
+
+void particle_simulation::ParticleSimulation::writeVectorFieldParameters()
+{
+    SimulationParameters& block = parameters.edit();
+    block.vectorFieldCount = static_cast<GLint>(vectorFieldTextures.size());
+
+    for (size_t i = 0; i < vectorFieldTextures.size(); i++)
+    {
+        const VectorFieldSettings& settings = vectorFieldSettings[i];
+
+        // Positions go world -> local -> texture coordinates; field vectors go local -> world
+        block.vectorFieldWorldToVolume[i] = vectorFieldLocalToVolumes[i] * glm::inverse(settings.transform);
+        block.vectorFieldToWorld[i] = glm::mat4(glm::mat3(settings.transform));
+        block.vectorFieldForces[i] = glm::vec4(settings.intensity, settings.tightness, 0.0f, 0.0f);
+    }
+}
+
+void particle_simulation::ParticleSimulation::writeDensityParameters()
 {
-    glDeleteBuffers(1, &particleBuffer);
-    glDeleteVertexArrays(1, &renderVAO);
-    glDeleteBuffers(1, &billboardVBO);
-    glDeleteProgram(renderProgram);
-    glDeleteProgram(computeProgram);
-    glDeleteTextures(1, &smokeTexture);
+    SimulationParameters& block = parameters.edit();
+    block.densityRadius = density.radius;
+    block.densityStrength = density.strength;
+    block.densityMaxNeighbours = density.maxNeighbours;
 }
 
-void particle_simulation::ParticleSimulation::destroy()
+void particle_simulation::ParticleSimulation::writeDepthCollisionParameters()
 {
-    glUseProgram(computeProgram);
-    ShaderUtils::setUniformInt(computeProgram, "emitterAlive", 0);
+    SimulationParameters& block = parameters.edit();
+    block.depthCollisionEnabled = depthCollisionTexture != 0 ? 1u : 0u;
+    block.depthViewProjection = depthViewProjection;
+    block.depthInverseViewProjection = glm::inverse(depthViewProjection);
+    block.depthCameraPosition = depthCameraPosition;
+    block.depthTexelSize = depthTexelSize;
+    block.collisionRestitution = depthCollision.restitution;
+    block.collisionFriction = depthCollision.friction;
+    block.collisionThickness = depthCollision.thickness;
+}
+
+void particle_simulation::ParticleSimulation::writeHeightfieldParameters()
+{
+    SimulationParameters& block = parameters.edit();
+    block.heightfieldEnabled = heightfieldTexture != 0 ? 1u : 0u;
+    block.heightfieldOrigin = heightfieldOrigin;
+    block.heightfieldSize = heightfieldSize;
+    block.heightfieldScale = heightfieldScale;
+    block.heightfieldResponse = glm::vec3(heightfieldResponse.restitution, heightfieldResponse.friction,
+        heightfieldResponse.killOnContact ? 1.0f : 0.0f);
+}
+
+void particle_simulation::ParticleSimulation::writeTrailParameters()
+{
+    SimulationParameters& block = parameters.edit();
+    block.trailWidth = trails.width;
+}
+
+void particle_simulation::ParticleSimulation::uploadTable(GLuint& buffer, size_t& bufferSize, const void* data, size_t size)
+{
+    if (buffer == 0)
+    {
+        glGenBuffers(1, &buffer);
+    }
+
+    // Grow to fit; shrinking only lowers the count the kernel loops over
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    if (size > bufferSize || bufferSize == 0)
+    {
+        bufferSize = std::max<size_t>(size, 1024);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, bufferSize, nullptr, GL_DYNAMIC_DRAW);
+    }
+
+    if (size > 0)
+    {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, size, data);
+    }
+}
+
+void particle_simulation::ParticleSimulation::uploadColliders()
+{
+    uploadTable(colliderBuffer, colliderBufferSize, colliders.data(), colliders.size() * sizeof(ColliderData));
+    parameters.edit().colliderCount = static_cast<GLuint>(colliders.size());
+    bCollidersDirty = false;
+}
+
+void particle_simulation::ParticleSimulation::uploadForces()
+{
+    uploadTable(forceBuffer, forceBufferSize, forces.data(), forces.size() * sizeof(ForceData));
+    parameters.edit().forceCount = static_cast<GLuint>(forces.size());
+    bForcesDirty = false;
+}
+
+const char* particle_simulation::particleLayoutName(ParticleLayout layout)
+{
+    switch (layout)
+    {
+    case ParticleLayout::SoA:
+        return "soa";
+    case ParticleLayout::Packed:
+        return "packed";
+    default:
+        return "aos";
+    }
+}
+
+namespace
+{
+    // SoA streams are padded so every range starts on a 1 KiB boundary, above any driver's
+    // GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT
+    GLsizeiptr streamCapacity(int capacity)
+    {
+        return (static_cast<GLsizeiptr>(capacity) + 63) / 64 * 64;
+    }
+}
+
+std::string particle_simulation::ParticleSimulation::layoutDefines() const
+{
+    return "#define PARTICLE_LAYOUT " + std::to_string(static_cast<int>(layout)) + "\n";
+}
+
+std::string particle_simulation::ParticleSimulation::trailDefines() const
+{
+    return "#define TRAIL_LENGTH " + std::to_string(trails.length) + "\n";
+}
+
+GLsizeiptr particle_simulation::ParticleSimulation::particleBufferSize(int capacity) const
+{
+    switch (layout)
+    {
+    case ParticleLayout::SoA:
+        return streamCapacity(capacity) * (3 * sizeof(glm::vec4) + sizeof(float));
+    case ParticleLayout::Packed:
+        return capacity * sizeof(PackedParticle);
+    default:
+        return capacity * sizeof(Particle);
+    }
+}
+
+void particle_simulation::ParticleSimulation::bindParticleStreams(GLuint buffer, int capacity, unsigned streams, bool bOutput) const
+{
+    // AoS and packed particles are a single array
+    if (layout != ParticleLayout::SoA)
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bOutput ? binding::particlesOut : binding::particles, buffer);
+        return;
+    }
+
+    // Positions, colors, velocities, then lifetimes
+    const GLsizeiptr vectorStreamSize = streamCapacity(capacity) * sizeof(glm::vec4);
+
+    if (streams & stream::position)
+    {
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, bOutput ? binding::particlesOut : binding::particles,
+            buffer, 0, vectorStreamSize);
+    }
+    if (streams & stream::color)
+    {
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, bOutput ? binding::particleColorsOut : binding::particleColors,
+            buffer, vectorStreamSize, vectorStreamSize);
+    }
+    if (streams & stream::velocity)
+    {
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, bOutput ? binding::particleVelocitiesOut : binding::particleVelocities,
+            buffer, 2 * vectorStreamSize, vectorStreamSize);
+    }
+    if (streams & stream::lifetime)
+    {
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, bOutput ? binding::particleLifetimesOut : binding::particleLifetimes,
+            buffer, 3 * vectorStreamSize, streamCapacity(capacity) * sizeof(float));
+    }
+}
+
+void particle_simulation::ParticleSimulation::uploadParticles(GLuint buffer, const std::vector<Particle>& particles) const
+{
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+
+    if (layout == ParticleLayout::AoS)
+    {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, particles.size() * sizeof(Particle), particles.data());
+        return;
+    }
+
+    if (layout == ParticleLayout::Packed)
+    {
+        std::vector<PackedParticle> packedParticles(particles.size());
+        for (size_t i = 0; i < particles.size(); i++)
+        {
+            packedParticles[i] = packParticle(particles[i], static_cast<uint32_t>(i));
+        }
+
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, packedParticles.size() * sizeof(PackedParticle), packedParticles.data());
+        return;
+    }
+
+    // particles covers the whole buffer, so its size is the capacity the streams were laid out for
+    std::vector<glm::vec4> positions(particles.size());
+    std::vector<glm::vec4> colors(particles.size());
+    std::vector<glm::vec4> velocities(particles.size());
+    std::vector<float> lifetimes(particles.size());
+
+    for (size_t i = 0; i < particles.size(); i++)
+    {
+        positions[i] = particles[i].position;
+        colors[i] = particles[i].color;
+        velocities[i] = glm::vec4(glm::vec3(particles[i].velocity), 0.0f);
+        lifetimes[i] = particles[i].velocity.w;
+    }
+
+    const GLsizeiptr vectorStreamSize = streamCapacity(static_cast<int>(particles.size())) * sizeof(glm::vec4);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, positions.size() * sizeof(glm::vec4), positions.data());
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, vectorStreamSize, colors.size() * sizeof(glm::vec4), colors.data());
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 2 * vectorStreamSize, velocities.size() * sizeof(glm::vec4), velocities.data());
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 3 * vectorStreamSize, lifetimes.size() * sizeof(float), lifetimes.data());
+}
+
+void particle_simulation::ParticleSimulation::createParticles()
+{
+    std::vector<Particle> particles(maxParticles);
+    
+    for (int i = 0; i < maxParticles; i++)
+    {
+        particles[i].velocity = glm::vec4(0.0f);
+    }
+
+    // Both state sets start out identical, so whichever one is read first is valid
+    for (const ParticleStateSet& stateSet : stateSets)
+    {
+        uploadParticles(stateSet.particleBuffer, particles);
+    }
+
+    glUseProgram(indirectArgsProgram);
+    ShaderUtils::setUniformInt(indirectArgsProgram, workGroupSizeUniform, updateKernelVariant.workGroupSize);
+    ShaderUtils::setUniformInt(indirectArgsProgram, ribbonStripVerticesUniform, bTrails ? 2 * trails.length : 0);
+
+    // Every slot starts on the dead list; the emitter brings them to life
+    std::vector<GLuint> deadIndices(maxParticles);
+    std::iota(deadIndices.begin(), deadIndices.end(), 0u);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, deadListBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, maxParticles * sizeof(GLuint), deadIndices.data());
+
+    // Stamp every trail entry with a tick the ribbons never ask for before a particle overwrites it
+    if (bTrails)
+    {
+        const glm::uvec4 emptyEntry(0u, 0u, 0u, 0x80000000u);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, trailHistoryBuffer);
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_RGBA32UI, GL_RGBA_INTEGER, GL_UNSIGNED_INT, &emptyEntry);
+    }
+
+    currentStateSet = 0;
+    renderStateSet = 0;
+    frameIndex = 0;
+    tickAccumulator = 0.0;
+    simulationTime = 0.0;
+    interpolationAlpha = 0.0f;
+
+    for (ParticleEmitter& emitter : emitters)
+    {
+        emitter.reset();
+    }
+
+    ParticleCounters counters = { 0, 0, maxParticles, 0 };
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(ParticleCounters), &counters);
+
+    IndirectArgs indirectArgs =
+    {
+        0, 1, 1, 0,
+        4, 0, 0, 0,
+        0, 0, 0, 0
+    };
+    for (const ParticleStateSet& stateSet : stateSets)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, stateSet.indirectBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(IndirectArgs), &indirectArgs);
+    }
+}
+
+void particle_simulation::ParticleSimulation::update(double deltaTime)
+{
+    // A replay swaps in the recorded delta, after the calls that came before it
+    if (recording.isReplaying())
+    {
+        replayUntil(InputEvent::Update);
+        if (recording.isReplaying())
+        {
+            const double recordedDelta = recording.read<double>();
+            if (recording.readComplete())
+            {
+                deltaTime = recordedDelta;
+            }
+        }
+    }
+    else
+    {
+        recording.record(InputEvent::Update, deltaTime);
+    }
+
+    const double tickDelta = 1.0 / tickRate;
+
+    // Paused, only requested steps run; the accumulator keeps its fraction for when play resumes
+    if (bPause)
+    {
+        if (pendingSteps > 0)
+        {
+            for (int step = 0; step < std::min(pendingSteps, maxSubsteps); step++)
+            {
+                tick(tickDelta);
+            }
+            pendingSteps = 0;
+
+            // Show the stepped state itself rather than the one before it. Nothing else runs
+            // while paused, so waiting for it here costs nothing.
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+            renderStateSet = currentStateSet;
+            interpolationAlpha = 1.0f;
+        }
+        return;
+    }
+
+    // Out of view for long enough, the simulation sleeps and only counts the time it misses
+    if (bSleepEnabled && bRendered)
+    {
+        if (!boxInFrustum(lastViewProjection, boundsMin, boundsMax))
+        {
+            if (framesOutOfView >= sleep.framesBeforeSleep)
+            {
+                sleptTime += deltaTime * timeScale;
+                return;
+            }
+            framesOutOfView++;
+        }
+        else
+        {
+            framesOutOfView = 0;
+            if (sleptTime > 0.0)
+            {
+                fastForward(sleptTime, 1, true);
+                sleptTime = 0.0;
+            }
+        }
+    }
+
+    // Run whole fixed ticks; the remainder carries over to the next frame. A time scale of 0
+    // never fills the accumulator, so a frozen system never ticks.
+    tickAccumulator += deltaTime * timeScale;
+
+    int substeps = 0;
+    while (tickAccumulator >= tickDelta && substeps < maxSubsteps)
+    {
+        tick(tickDelta);
+        tickAccumulator -= tickDelta;
+        substeps++;
+    }
+
+    // After a hitch, drop the backlog instead of spiralling into ever more substeps
+    if (tickAccumulator >= tickDelta)
+    {
+        tickAccumulator = std::fmod(tickAccumulator, tickDelta);
+    }
+
+    interpolationAlpha = static_cast<float>(tickAccumulator / tickDelta);
+}
+
+void particle_simulation::ParticleSimulation::setTickRate(double ticksPerSecond, int maxSubstepsPerUpdate)
+{
+    if (!acceptsInput())
+    {
+        return;
+    }
+    recording.record(InputEvent::TickRate, ticksPerSecond, static_cast<int32_t>(maxSubstepsPerUpdate));
+
+    tickRate = std::max(ticksPerSecond, 1.0);
+    maxSubsteps = std::max(maxSubstepsPerUpdate, 1);
+}
+
+void particle_simulation::ParticleSimulation::fastForward(double duration, int steps, bool bCatchUp)
+{
+    // Every particle alive now was born in the last maxLifetime seconds, so time before that
+    // only has to advance the emitter clocks
+    const double window = std::min(duration, static_cast<double>(getMaxParticleLifetime()));
+    if (window <= 0.0)
+    {
+        return;
+    }
+
+    for (ParticleEmitter& emitter : emitters)
+    {
+        emitter.emit(duration - window, qualityScale);
+    }
+    simulationTime += duration - window;
+
+    // Spawns spread their births across each tick, so even one tick seeds a full range of ages
+    steps = std::max(steps, 1);
+    for (int step = 0; step < steps; step++)
+    {
+        tick(window / steps, bCatchUp);
+    }
+
+    // Draw the result straight away rather than the state from before the jump
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+    renderStateSet = currentStateSet;
+}
+
+void particle_simulation::ParticleSimulation::tick(double deltaTime, bool bCatchUp)
+{
+    const ParticleStateSet& input = stateSets[currentStateSet];
+    const ParticleStateSet& output = stateSets[1 - currentStateSet];
+
+    glUseProgram(computeProgram);
+    bindUpdateTextures();
+    if (bCollidersDirty)
+    {
+        uploadColliders();
+    }
+    if (bForcesDirty)
+    {
+        uploadForces();
+    }
+
+    // Only the tick clock changes from tick to tick, so this is usually a 16 byte upload
+    SimulationParameters& block = parameters.edit();
+    block.deltaTime = static_cast<float>(deltaTime);
+    block.simulationTime = static_cast<float>(simulationTime);
+    block.frameIndex = frameIndex;
+    block.catchUpTick = bCatchUp ? 1u : 0u;
+    parameters.upload();
+    parameters.bind();
+
+    bindParticleStreams(input.particleBuffer, maxParticles, stream::all);
+    bindParticleStreams(output.particleBuffer, maxParticles, stream::all, true);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::deadList, deadListBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::aliveListIn, input.aliveListBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::aliveListOut, output.aliveListBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::counters, counterBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::previousPositions, output.previousPositionBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::emitters, emitterBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::particleEmitters, input.particleEmitterBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::particleEmittersOut, output.particleEmitterBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::colliders, colliderBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::forces, forceBuffer);
+    if (bTrails)
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::trailHistory, trailHistoryBuffer);
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::emitterPaths, emitterPathBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::emitterPathKeys, emitterPathKeyBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::emitterSpawnCounts, emitterSpawnCountBuffer);
+
+    // Spawn counts are the only per-emitter data the CPU still produces every tick
+    simulationTime += deltaTime;
+
+    GLuint totalSpawnCount = 0;
+    for (size_t i = 0; i < emitters.size(); i++)
+    {
+        // Prewarm and wake-up ticks are longer than a fixed tick and get a budget to match
+        emitterSpawnCounts[i] = static_cast<GLuint>(emitters[i].emit(deltaTime, qualityScale, deltaTime * tickRate));
+        totalSpawnCount += emitterSpawnCounts[i];
+    }
+
+    if (!emitters.empty())
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, emitterSpawnCountBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, emitterSpawnCounts.size() * sizeof(GLuint), emitterSpawnCounts.data());
+
+        // Move every emitter along its path over this tick; it reads nothing the previous tick wrote
+        glUseProgram(emitterMotionProgram);
+        glDispatchCompute(static_cast<GLuint>((emitters.size() + emitterMotionWorkGroupSize - 1) / emitterMotionWorkGroupSize), 1, 1);
+        glUseProgram(computeProgram);
+    }
+
+    // Makes the set written last tick, now this tick's input, and the emitter locations visible.
+    // The draw never waits on this barrier: it reads the set this tick reads, so it can overlap the whole tick
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+    // Sort this tick's particles into the grid before the update kernel queries it; a catch-up
+    // tick applies no density repulsion
+    if (bDensityRepulsion && !bCatchUp)
+    {
+        spatialGrid.build(input.indirectBuffer);
+        glUseProgram(computeProgram);
+    }
+
+    // Only the particles alive after the previous update are simulated
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, input.indirectBuffer);
+    glDispatchComputeIndirect(offsetof(IndirectArgs, dispatchX));
+
+    // Spawn this update's new particles into the freshly written alive list
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // One workgroup per emitter covers every emitter in a single dispatch
+    if (totalSpawnCount > 0)
+    {
+        glUseProgram(spawnProgram);
+        glDispatchCompute(static_cast<GLuint>(emitters.size()), 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    // Turn the new alive count into the draw arguments and the next dispatch size
+    glUseProgram(indirectArgsProgram);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::indirectArgs, output.indirectBuffer);
+    glDispatchCompute(1, 1, 1);
+
+    // Draw what this tick started from; it is complete and nothing writes it until the next tick
+    renderStateSet = currentStateSet;
+    currentStateSet = 1 - currentStateSet;
+    frameIndex++;
+}
+
+void particle_simulation::ParticleSimulation::beginBlend()
+{
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+}
+
+void particle_simulation::ParticleSimulation::endBlend()
+{
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+}
+
+void particle_simulation::ParticleSimulation::render(const glm::mat4& liveViewMatrix, const glm::mat4& liveProjectionMatrix)
+{
+    // A replay draws from the recorded camera, which also decides the off-screen sleep
+    glm::mat4 viewMatrix = liveViewMatrix;
+    glm::mat4 projectionMatrix = liveProjectionMatrix;
+    if (recording.isReplaying())
+    {
+        replayUntil(InputEvent::Render);
+        if (recording.isReplaying())
+        {
+            const glm::mat4 recordedView = recording.read<glm::mat4>();
+            const glm::mat4 recordedProjection = recording.read<glm::mat4>();
+            if (recording.readComplete())
+            {
+                viewMatrix = recordedView;
+                projectionMatrix = recordedProjection;
+            }
+        }
+    }
+    else
+    {
+        recording.record(InputEvent::Render, viewMatrix, projectionMatrix);
+    }
+
+    // The next update decides whether to sleep from this frame's camera
+    lastViewProjection = projectionMatrix * viewMatrix;
+    bRendered = true;
+    if (bSleepEnabled && !boxInFrustum(lastViewProjection, boundsMin, boundsMax))
+    {
+        return;
+    }
+
+    SimulationParameters& block = parameters.edit();
+    block.viewProjMatrix = lastViewProjection;
+    block.viewMatrix = viewMatrix;
+    block.interpolationAlpha = interpolationAlpha;
+
+    // Ribbons count their history back from the tick that read the drawn set: normally the last
+    // tick, or the one after it once a paused step has made the newest set the drawn one
+    block.frameIndex = renderStateSet == currentStateSet ? frameIndex : frameIndex - 1;
+    parameters.upload();
+    parameters.bind();
+
+    // One tick behind the simulation, which is what lets the draw skip the barrier
+    const ParticleStateSet& stateSet = stateSets[renderStateSet];
+    bindParticleStreams(stateSet.particleBuffer, maxParticles, stream::position | stream::color | stream::lifetime);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::aliveListIn, stateSet.aliveListBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::previousPositions, stateSet.previousPositionBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::emitters, emitterBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::particleEmitters, stateSet.particleEmitterBuffer);
+
+    // Instance counts are the alive count written by the indirect args kernel
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, stateSet.indirectBuffer);
+
+    // Ribbons first, so the particle sprites blend over their own trails
+    if (bTrails)
+    {
+        glUseProgram(ribbonProgram);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::trailHistory, trailHistoryBuffer);
+        glBindVertexArray(ribbonVAO);
+        glDrawArraysIndirect(GL_TRIANGLE_STRIP, reinterpret_cast<const void*>(offsetof(IndirectArgs, ribbonVertexCount)));
+    }
+
+    glUseProgram(renderProgram);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, spriteSheetArray);
+
+    glBindVertexArray(renderVAO);
+    glDrawArraysIndirect(GL_TRIANGLE_STRIP, reinterpret_cast<const void*>(offsetof(IndirectArgs, drawVertexCount)));
+
+}
+
+void particle_simulation::ParticleSimulation::setEmission(int emitterId, const EmissionSettings& settings)
+{
+    if (!acceptsInput())
+    {
+        return;
+    }
+    recording.record(InputEvent::Emission, static_cast<int32_t>(emitterId), settings);
+
+    emitters[emitterId].setEmission(settings);
+}
+
+void particle_simulation::ParticleSimulation::destroyEmitter(int emitterId)
+{
+    if (!acceptsInput())
+    {
+        return;
+    }
+    recording.record(InputEvent::DestroyEmitter, static_cast<int32_t>(emitterId));
+
+    emitters[emitterId].destroy();
+
+    // The alive flag only changes here, so only this row is uploaded
+    if (emitterBuffer != 0)
+    {
+        emitterData[emitterId].state.z = 0u;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, emitterBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, emitterId * sizeof(EmitterData) + offsetof(EmitterData, state),
+            sizeof(glm::uvec4), &emitterData[emitterId].state);
+    }
+}
+
+void particle_simulation::ParticleSimulation::setEmitterPath(int emitterId, const EmitterPath& path)
+{
+    if (!acceptsInput())
+    {
+        return;
+    }
+    recording.record(InputEvent::EmitterPath, static_cast<int32_t>(emitterId), path);
+
+    emitters[emitterId].setPath(path);
+
+    if (emitterPathBuffer != 0)
+    {
+        createEmitterPaths();
+    }
+    if (bSleepEnabled)
+    {
+        updateBounds();
+    }
+}
+
+void particle_simulation::ParticleSimulation::setTurbulence(const TurbulenceSettings& settings)
+{
+    if (!acceptsInput())
+    {
+        return;
+    }
+    recording.record(InputEvent::Turbulence, settings);
+
+    const CurlNoiseSettings& current = turbulence.noise;
+    const bool rebake = settings.noise.resolution != current.resolution ||
+        settings.noise.period != current.period ||
+        settings.noise.octaves != current.octaves ||
+        settings.noise.persistence != current.persistence ||
+        settings.noise.seed != current.seed;
+
+    turbulence = settings;
+
+    // Before init() the settings are simply picked up there
+    if (computeProgram == 0)
+        return;
+
+    if (rebake)
+    {
+        createTurbulenceField();
+    }
+
+    writeTurbulenceParameters();
+}
+
+void particle_simulation::ParticleSimulation::setVectorFieldTransform(int fieldId, const glm::mat4& transform)
+{
+    if (!acceptsInput())
+    {
+        return;
+    }
+    recording.record(InputEvent::VectorFieldTransform, static_cast<int32_t>(fieldId), transform);
+
+    vectorFieldSettings[fieldId].transform = transform;
+
+    // Before init() the volume mapping isn't known yet; init() writes the parameters
+    if (computeProgram != 0)
+    {
+        writeVectorFieldParameters();
+    }
+}
+
+void particle_simulation::ParticleSimulation::setDepthCollision(GLuint depthTexture, const glm::mat4& viewMatrix,
+    const glm::mat4& projectionMatrix, const DepthCollisionSettings& settings)
+{
+    // The texture only means something in this run's context, so it comes from the live call
+    // even while a replay supplies the matrices
+    setDepthCollisionTexture(depthTexture);
+    if (!acceptsInput())
+    {
+        writeDepthCollisionParameters();
+        return;
+    }
+    recording.record(InputEvent::DepthCollision, viewMatrix, projectionMatrix, settings);
+
+    depthViewProjection = projectionMatrix * viewMatrix;
+    depthCameraPosition = glm::vec3(glm::inverse(viewMatrix)[3]);
+    depthCollision = settings;
+
+    writeDepthCollisionParameters();
+}
+
+void particle_simulation::ParticleSimulation::setDepthCollisionTexture(GLuint depthTexture)
+{
+    depthCollisionTexture = depthTexture;
+
+    if (depthTexture != 0)
+    {
+        GLint width = 1;
+        GLint height = 1;
+        glBindTexture(GL_TEXTURE_2D, depthTexture);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+        depthTexelSize = glm::vec2(1.0f / std::max(width, 1), 1.0f / std::max(height, 1));
+    }
+}
+
+int particle_simulation::ParticleSimulation::addCollider(const ColliderData& collider)
+{
+    if (!acceptsInput())
+    {
+        return -1;
+    }
+    recording.record(InputEvent::AddCollider, collider);
+
+    colliders.push_back(collider);
+    bCollidersDirty = true;
+    return static_cast<int>(colliders.size()) - 1;
+}
+
+void particle_simulation::ParticleSimulation::setCollider(int colliderId, const ColliderData& collider)
+{
+    if (!acceptsInput())
+    {
+        return;
+    }
+    recording.record(InputEvent::SetCollider, static_cast<int32_t>(colliderId), collider);
+
+    colliders[colliderId] = collider;
+    bCollidersDirty = true;
+}
+
+void particle_simulation::ParticleSimulation::clearColliders()
+{
+    if (!acceptsInput())
+    {
+        return;
+    }
+    recording.record(InputEvent::ClearColliders);
+
+    colliders.clear();
+    bCollidersDirty = true;
+}
+
+int particle_simulation::ParticleSimulation::addForce(const ForceData& force)
+{
+    if (!acceptsInput())
+    {
+        return -1;
+    }
+    recording.record(InputEvent::AddForce, force);
+
+    forces.push_back(force);
+    bForcesDirty = true;
+    return static_cast<int>(forces.size()) - 1;
+}
+
+void particle_simulation::ParticleSimulation::setForce(int forceId, const ForceData& force)
+{
+    if (!acceptsInput())
+    {
+        return;
+    }
+    recording.record(InputEvent::SetForce, static_cast<int32_t>(forceId), force);
+
+    forces[forceId] = force;
+    bForcesDirty = true;
+}
+
+void particle_simulation::ParticleSimulation::clearForces()
+{
+    if (!acceptsInput())
+    {
+        return;
+    }
+    recording.record(InputEvent::ClearForces);
+
+    forces.clear();
+    bForcesDirty = true;
+}
+
+void particle_simulation::ParticleSimulation::setHeightfield(GLuint texture, const glm::vec3& origin, const glm::vec2& size,
+    float heightScale, const ColliderResponse& response)
+{
+    // As with depth collision, the texture is taken from the live call during a replay
+    heightfieldTexture = texture;
+    if (!acceptsInput())
+    {
+        writeHeightfieldParameters();
+        return;
+    }
+    recording.record(InputEvent::Heightfield, origin, size, heightScale, response);
+
+    heightfieldOrigin = origin;
+    heightfieldSize = size;
+    heightfieldScale = heightScale;
+    heightfieldResponse = response;
+
+    writeHeightfieldParameters();
+}
+
+void particle_simulation::ParticleSimulation::enableDensityRepulsion(const DensitySettings& settings)
+{
+    density = settings;
+    density.radius = std::min(density.radius, density.grid.cellSize);
+    spatialGrid = SpatialGrid(density.grid);
+    bDensityRepulsion = true;
+}
+
+void particle_simulation::ParticleSimulation::enableTrails(const TrailSettings& settings)
+{
+    trails = settings;
+    trails.length = std::clamp(trails.length, 2, maxTrailLength);
+    bTrails = true;
+}
+
+void particle_simulation::ParticleSimulation::enableOffscreenSleep(const SleepSettings& settings)
+{
+    sleep = settings;
+    bSleepEnabled = true;
+    framesOutOfView = 0;
+    updateBounds();
+}
+
+bool particle_simulation::ParticleSimulation::isSleeping() const
+{
+    return bSleepEnabled && framesOutOfView >= sleep.framesBeforeSleep && sleptTime > 0.0;
+}
+
+void particle_simulation::ParticleSimulation::setPrewarm(const PrewarmSettings& settings)
+{
+    prewarm = settings;
+}
+
+bool particle_simulation::ParticleSimulation::startRecording(const std::string& path)
+{
+    return recording.startRecording(path);
+}
+
+bool particle_simulation::ParticleSimulation::startReplay(const std::string& path)
+{
+    return recording.startReplay(path);
+}
+
+bool particle_simulation::ParticleSimulation::isReplaying() const
+{
+    return recording.isReplaying();
+}
+
+bool particle_simulation::ParticleSimulation::acceptsInput() const
+{
+    return !recording.isReplaying() || bApplyingReplay;
+}
+
+void particle_simulation::ParticleSimulation::replayUntil(InputEvent until)
+{
+    bApplyingReplay = true;
+
+    // Ids come from the file, so they are checked against the live tables before use; a
+    // recording of a different scene stops here instead of writing out of bounds
+    const auto inRange = [this](int32_t id, size_t count, const char* table)
+    {
+        if (id >= 0 && static_cast<size_t>(id) < count)
+        {
+            return true;
+        }
+
+        std::cerr << "Recording names " << table << " " << id << " of " << count << "; replay stopped" << std::endl;
+        recording.stop();
+        return false;
+    };
+
+    // Every payload is read in full before anything is applied
+    InputEvent event;
+    while (recording.nextEvent(event) && event != until)
+    {
+        switch (event)
+        {
+        case InputEvent::Emission:
+        {
+            const int32_t emitterId = recording.read<int32_t>();
+            const EmissionSettings settings = recording.read<EmissionSettings>();
+            if (recording.readComplete() && inRange(emitterId, emitters.size(), "emitter"))
+            {
+                setEmission(emitterId, settings);
+            }
+            break;
+        }
+        case InputEvent::EmitterPath:
+        {
+            const int32_t emitterId = recording.read<int32_t>();
+            const EmitterPath path = recording.read<EmitterPath>();
+            if (recording.readComplete() && inRange(emitterId, emitters.size(), "emitter"))
+            {
+                setEmitterPath(emitterId, path);
+            }
+            break;
+        }
+        case InputEvent::DestroyEmitter:
+        {
+            const int32_t emitterId = recording.read<int32_t>();
+            if (recording.readComplete() && inRange(emitterId, emitters.size(), "emitter"))
+            {
+                destroyEmitter(emitterId);
+            }
+            break;
+        }
+        case InputEvent::Paused:
+        {
+            const bool bPaused = recording.read<uint8_t>() != 0;
+            if (recording.readComplete())
+            {
+                setPaused(bPaused);
+            }
+            break;
+        }
+        case InputEvent::TimeScale:
+        {
+            const float scale = recording.read<float>();
+            if (recording.readComplete())
+            {
+                setTimeScale(scale);
+            }
+            break;
+        }
+        case InputEvent::StepTick:
+            stepTick();
+            break;
+        case InputEvent::TickRate:
+        {
+            const double ticksPerSecond = recording.read<double>();
+            const int32_t maxSubstepsPerUpdate = recording.read<int32_t>();
+            if (recording.readComplete())
+            {
+                setTickRate(ticksPerSecond, maxSubstepsPerUpdate);
+            }
+            break;
+        }
+        case InputEvent::AddCollider:
+        {
+            const ColliderData collider = recording.read<ColliderData>();
+            if (recording.readComplete())
+            {
+                addCollider(collider);
+            }
+            break;
+        }
+        case InputEvent::SetCollider:
+        {
+            const int32_t colliderId = recording.read<int32_t>();
+            const ColliderData collider = recording.read<ColliderData>();
+            if (recording.readComplete() && inRange(colliderId, colliders.size(), "collider"))
+            {
+                setCollider(colliderId, collider);
+            }
+            break;
+        }
+        case InputEvent::ClearColliders:
+            clearColliders();
+            break;
+        case InputEvent::AddForce:
+        {
+            const ForceData force = recording.read<ForceData>();
+            if (recording.readComplete())
+            {
+                addForce(force);
+            }
+            break;
+        }
+        case InputEvent::SetForce:
+        {
+            const int32_t forceId = recording.read<int32_t>();
+            const ForceData force = recording.read<ForceData>();
+            if (recording.readComplete() && inRange(forceId, forces.size(), "force"))
+            {
+                setForce(forceId, force);
+            }
+            break;
+        }
+        case InputEvent::ClearForces:
+            clearForces();
+            break;
+        case InputEvent::QualityScale:
+        {
+            const float scale = recording.read<float>();
+            if (recording.readComplete())
+            {
+                setQualityScale(scale);
+            }
+            break;
+        }
+        case InputEvent::VectorFieldTransform:
+        {
+            const int32_t fieldId = recording.read<int32_t>();
+            const glm::mat4 transform = recording.read<glm::mat4>();
+            if (recording.readComplete() && inRange(fieldId, vectorFieldSettings.size(), "vector field"))
+            {
+                setVectorFieldTransform(fieldId, transform);
+            }
+            break;
+        }
+        case InputEvent::DepthCollision:
+        {
+            const glm::mat4 viewMatrix = recording.read<glm::mat4>();
+            const glm::mat4 projectionMatrix = recording.read<glm::mat4>();
+            const DepthCollisionSettings settings = recording.read<DepthCollisionSettings>();
+            if (recording.readComplete())
+            {
+                setDepthCollision(depthCollisionTexture, viewMatrix, projectionMatrix, settings);
+            }
+            break;
+        }
+        case InputEvent::Heightfield:
+        {
+            const glm::vec3 origin = recording.read<glm::vec3>();
+            const glm::vec2 size = recording.read<glm::vec2>();
+            const float heightScale = recording.read<float>();
+            const ColliderResponse response = recording.read<ColliderResponse>();
+            if (recording.readComplete())
+            {
+                setHeightfield(heightfieldTexture, origin, size, heightScale, response);
+            }
+            break;
+        }
+        case InputEvent::Turbulence:
+        {
+            const TurbulenceSettings settings = recording.read<TurbulenceSettings>();
+            if (recording.readComplete())
+            {
+                setTurbulence(settings);
+            }
+            break;
+        }
+        default:
+            // An update where a render was due, the other way round, or not an event at all
+            std::cerr << "Update and render calls no longer match the recording; replay stopped" << std::endl;
+            recording.stop();
+            break;
+        }
+    }
+
+    bApplyingReplay = false;
+}
+
+void particle_simulation::ParticleSimulation::updateBounds()
+{
+    boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+
+    for (const ParticleEmitter& emitter : emitters)
+    {
+        const EmitterSettings& settings = emitter.getSettings();
+
+        glm::vec3 pathMin = settings.location;
+        glm::vec3 pathMax = settings.location;
+        expandEmitterPathBounds(settings.path, settings.location, pathMin, pathMax);
+
+        // Particles start anywhere in the spawn sphere and travel up to the reach from there
+        const glm::vec3 padding(settings.sphereRadius + sleep.particleReach);
+        boundsMin = glm::min(boundsMin, pathMin - padding);
+        boundsMax = glm::max(boundsMax, pathMax + padding);
+    }
+}
+
+void particle_simulation::ParticleSimulation::setPaused(bool bPaused)
+{
+    if (!acceptsInput())
+    {
+        return;
+    }
+    recording.record(InputEvent::Paused, static_cast<uint8_t>(bPaused));
+
+    bPause = bPaused;
+    pendingSteps = 0;
+}
+
+bool particle_simulation::ParticleSimulation::isPaused() const
+{
+    return bPause;
+}
+
+void particle_simulation::ParticleSimulation::setTimeScale(float scale)
+{
+    if (!acceptsInput())
+    {
+        return;
+    }
+    recording.record(InputEvent::TimeScale, scale);
+
+    timeScale = std::max(scale, 0.0f);
+}
+
+float particle_simulation::ParticleSimulation::getTimeScale() const
+{
+    return timeScale;
+}
+
+void particle_simulation::ParticleSimulation::setQualityScale(float scale)
+{
+    if (!acceptsInput())
+    {
+        return;
+    }
+    recording.record(InputEvent::QualityScale, scale);
+
+    qualityScale = std::clamp(scale, 0.0f, 1.0f);
+}
+
+float particle_simulation::ParticleSimulation::getQualityScale() const
+{
+    return qualityScale;
+}
+
+float particle_simulation::ParticleSimulation::getMaxParticleLifetime() const
+{
+    float maxLifetime = 0.0f;
+    for (const ParticleEmitter& emitter : emitters)
+    {
+        maxLifetime = std::max(maxLifetime, emitter.getSettings().maxParticleLifetime);
+    }
+    return maxLifetime;
+}
+
+void particle_simulation::ParticleSimulation::stepTick()
+{
+    if (!acceptsInput())
+    {
+        return;
+    }
+    recording.record(InputEvent::StepTick);
+
+    if (bPause)
+    {
+        pendingSteps++;
+    }
+}
+
+particle_simulation::ParticleLayout particle_simulation::ParticleSimulation::getLayout() const
+{
+    return layout;
+}
+
+GLuint particle_simulation::ParticleSimulation::readAliveCount() const
+{
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    ParticleCounters counters = {};
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(ParticleCounters), &counters);
+
+    return counters.aliveCount;
+}
+
+particle_simulation::FrameTraffic particle_simulation::ParticleSimulation::estimateFrameTraffic(GLuint aliveCount) const
+{
+    // Per particle, whatever the layout: alive list entries, emitter id read and copied across,
+    // and previous position
+    size_t updateBytes = 4 * sizeof(GLuint) + sizeof(glm::vec4);
+    size_t renderBytes = 2 * sizeof(GLuint) + sizeof(glm::vec4);
+
+    switch (layout)
+    {
+    case ParticleLayout::SoA:
+        // Every stream is read and written; drawing reads position, color and lifetime only
+        updateBytes += 2 * (3 * sizeof(glm::vec4) + sizeof(float));
+        renderBytes += 2 * sizeof(glm::vec4) + sizeof(float);
+        break;
+    case ParticleLayout::Packed:
+        // As AoS, on a struct half the size
+        updateBytes += 2 * sizeof(PackedParticle);
+        renderBytes += sizeof(PackedParticle);
+        break;
+    default:
+        // The whole struct is read and written back; drawing pulls in the cache lines of
+        // the entire struct even though velocity.xyz is never used
+        updateBytes += 2 * sizeof(Particle);
+        renderBytes += sizeof(Particle);
+        break;
+    }
+
+    // One history entry written per tick; each ribbon reads the whole history
+    if (bTrails)
+    {
+        updateBytes += sizeof(glm::uvec4);
+        renderBytes += trails.length * sizeof(glm::uvec4);
+    }
+
+    return { aliveCount * updateBytes, aliveCount * renderBytes };
+}
+
+void particle_simulation::ParticleSimulation::cleanup()
+{
+    for (ParticleStateSet& stateSet : stateSets)
+    {
+        deleteBuffer(stateSet.particleBuffer);
+        deleteBuffer(stateSet.previousPositionBuffer);
+        deleteBuffer(stateSet.particleEmitterBuffer);
+        deleteBuffer(stateSet.aliveListBuffer);
+        deleteBuffer(stateSet.indirectBuffer);
+    }
+    deleteBuffer(deadListBuffer);
+    deleteBuffer(counterBuffer);
+    deleteBuffer(emitterBuffer);
+    deleteBuffer(emitterPathBuffer);
+    deleteBuffer(emitterPathKeyBuffer);
+    deleteBuffer(emitterSpawnCountBuffer);
+    deleteBuffer(trailHistoryBuffer);
+    deleteVertexArray(ribbonVAO);
+    ShaderUtils::deleteProgram(ribbonProgram);
+    deleteVertexArray(renderVAO);
+    deleteBuffer(billboardVBO);
+    ShaderUtils::deleteProgram(renderProgram);
+    ShaderUtils::deleteProgram(computeProgram);
+    ShaderUtils::deleteProgram(indirectArgsProgram);
+    ShaderUtils::deleteProgram(spawnProgram);
+    ShaderUtils::deleteProgram(emitterMotionProgram);
+    deleteTexture(spriteSheetArray);
+    deleteTexture(turbulenceField);
+    glDeleteTextures(static_cast<GLsizei>(vectorFieldTextures.size()), vectorFieldTextures.data());
+    vectorFieldTextures.clear();
+    spatialGrid.cleanup();
+    recording.stop();
+    deleteBuffer(colliderBuffer);
+    deleteBuffer(forceBuffer);
+    colliderBufferSize = 0;
+    forceBufferSize = 0;
+    parameters.cleanup();
+}
+
+void particle_simulation::ParticleSimulation::destroy()
+{
+    for (ParticleEmitter& emitter : emitters)
+    {
+        emitter.destroy();
+    }
+
     cleanup();
 }
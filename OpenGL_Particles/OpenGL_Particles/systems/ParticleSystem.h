@@ -5,74 +5,514 @@
 #include <gtc/matrix_transform.hpp>
 #include <gtc/type_ptr.hpp>
 #include <random>
+#include <string>
+#include <vector>
+
+#include "Collider.h"
+#include "CurlNoise.h"
+#include "ForceField.h"
+#include "InputRecording.h"
+#include "ParticlePacking.h"
+#include "ParticleEmitter.h"
+#include "SpatialGrid.h"
+#include "VectorField.h"
+#include "../utilities/KernelAutotuner.h"
+#include "../utilities/UniformBuffer.h"
 
 namespace particle_simulation
 {
-    struct Particle
+    // How particle attributes are stored; mirrors PARTICLE_LAYOUT in particle_layout.glsl
+    enum class ParticleLayout
+    {
+        AoS = 0,    // one interleaved Particle per slot
+        SoA = 1,    // separate position/size, color, velocity and lifetime streams
+        Packed = 2  // one PackedParticle per slot
+    };
+
+    // Short name for logs and the kernel cache
+    const char* particleLayoutName(ParticleLayout layout);
+
+    // Particle streams a pass binds; in the AoS layout any of them binds the whole array
+    namespace stream
+    {
+        constexpr unsigned position = 1u << 0;
+        constexpr unsigned color = 1u << 1;
+        constexpr unsigned velocity = 1u << 2;
+        constexpr unsigned lifetime = 1u << 3;
+        constexpr unsigned all = position | color | velocity | lifetime;
+    }
+
+    // Modelled memory traffic of one simulated and drawn frame, for comparing layouts
+    struct FrameTraffic
+    {
+        size_t updateBytes;
+        size_t renderBytes;
+    };
+
+    // SSBO binding points shared with the shaders
+    namespace binding
+    {
+        constexpr GLuint particles = 0;
+        constexpr GLuint deadList = 1;
+        constexpr GLuint aliveListIn = 2;
+        constexpr GLuint aliveListOut = 3;
+        constexpr GLuint counters = 4;
+        constexpr GLuint indirectArgs = 5;
+        constexpr GLuint previousPositions = 6;
+        constexpr GLuint emitters = 7;
+        constexpr GLuint particleEmitters = 8;
+        constexpr GLuint gridCells = 9;
+        constexpr GLuint gridSortedParticles = 10;
+        constexpr GLuint gridParticleCells = 11;
+        constexpr GLuint gridBlockSums = 12;
+        constexpr GLuint colliders = 13;
+        constexpr GLuint forces = 14;
+        constexpr GLuint particleColors = 15;       // SoA streams; binding 0 holds positions
+        constexpr GLuint particleVelocities = 16;
+        constexpr GLuint particleLifetimes = 17;
+        constexpr GLuint particlesOut = 18;         // the state set a tick writes, same layout as 0/15/16/17
+        constexpr GLuint particleColorsOut = 19;
+        constexpr GLuint particleVelocitiesOut = 20;
+        constexpr GLuint particleLifetimesOut = 21;
+        constexpr GLuint particleEmittersOut = 22;
+        constexpr GLuint trailHistory = 23;
+        constexpr GLuint emitterPaths = 24;
+        constexpr GLuint emitterPathKeys = 25;
+        constexpr GLuint emitterSpawnCounts = 26;
+    }
+
+    // Everything a tick writes that the render reads. Ticks read one set and write the other,
+    // so drawing the previous frame's set can overlap this frame's simulation.
+    struct ParticleStateSet
+    {
+        GLuint particleBuffer = 0;
+        GLuint previousPositionBuffer = 0;
+        GLuint particleEmitterBuffer = 0;
+        GLuint aliveListBuffer = 0;
+        GLuint indirectBuffer = 0;     // dispatch arguments for the tick reading the set, draw arguments for it
+    };
+
+    // Mirrors the Emitter struct in the shaders (std430, 96 bytes)
+    struct EmitterData
+    {
+        glm::vec4 position;           // xyz = location at the end of this tick, w = sphere radius
+        glm::vec4 previousPosition;   // xyz = location at the start of this tick, w = max lifetime
+        glm::vec4 textureRegion;      // xy = UV extent of the sprite sheet in its layer, z = layer
+        glm::ivec4 gridSize;          // xy = flipbook grid
+        glm::uvec4 state;             // x = unused, y = RNG seed, z = alive
+        glm::vec4 motion;             // x = followEmitter, y = inheritVelocity
+    };
+
+    // Mirrors the Counters block in compute.glsl / indirect_args.glsl
+    struct ParticleCounters
+    {
+        GLuint aliveCount;                  // particles simulated this frame
+        GLuint aliveCountAfterSimulation;   // particles appended to the output alive list
+        GLint deadCount;                    // free slots in the dead list
+        GLuint pad;
+    };
+
+    // Mirrors the IndirectArgs block in indirect_args.glsl
+    struct IndirectArgs
+    {
+        // DispatchIndirectCommand
+        GLuint dispatchX;
+        GLuint dispatchY;
+        GLuint dispatchZ;
+        GLuint pad;
+
+        // DrawArraysIndirectCommand for the billboards
+        GLuint drawVertexCount;
+        GLuint drawInstanceCount;
+        GLuint drawFirstVertex;
+        GLuint drawBaseInstance;
+
+        // DrawArraysIndirectCommand for the trail ribbons
+        GLuint ribbonVertexCount;
+        GLuint ribbonInstanceCount;
+        GLuint ribbonFirstVertex;
+        GLuint ribbonBaseInstance;
+    };
+
+    // Must match MAX_VECTOR_FIELDS in parameters.glsl; fields use texture units 1 to 4
+    constexpr int maxVectorFields = 4;
+
+    // Uniform buffer binding of the SimulationParameters block
+    constexpr GLuint parameterBlockBinding = 0;
+
+    // Mirrors the SimulationParameters block in parameters.glsl (std140, 976 bytes).
+    // Padding is explicit so the whole struct can be compared byte for byte.
+    struct SimulationParameters
     {
-        glm::vec4 position;   // xyz = position, w = size
-        glm::vec4 color;      // rgba = color
-        glm::vec4 velocity;   // xyz = velocity, w = lifetime
+        // Camera
+        glm::mat4 viewProjMatrix;
+        glm::mat4 viewMatrix;
+
+        // Depth collision
+        glm::mat4 depthViewProjection;
+        glm::mat4 depthInverseViewProjection;
+
+        // Vector fields
+        glm::mat4 vectorFieldWorldToVolume[maxVectorFields];
+        glm::mat4 vectorFieldToWorld[maxVectorFields];      // rotation and scale in the upper 3x3
+        glm::vec4 vectorFieldForces[maxVectorFields];       // x = intensity, y = tightness
+
+        glm::vec3 turbulenceScroll;
+        float turbulenceScale;
+        glm::vec3 depthCameraPosition;
+        float turbulenceStrength;
+        glm::vec3 heightfieldOrigin;
+        float heightfieldScale;
+        glm::vec3 heightfieldResponse;   // x = restitution, y = friction, z = kill on contact
+        float deltaTime;
+        glm::vec2 depthTexelSize;
+        glm::vec2 heightfieldSize;
+
+        float simulationTime;
+        float interpolationAlpha;
+        float collisionRestitution;
+        float collisionFriction;
+        float collisionThickness;
+        float densityRadius;
+        float densityStrength;
+        GLint densityMaxNeighbours;
+        GLint vectorFieldCount;
+        GLuint colliderCount;
+        GLuint forceCount;
+        GLuint frameIndex;
+        GLuint depthCollisionEnabled;    // GLSL bool
+        GLuint heightfieldEnabled;       // GLSL bool
+        float trailWidth;
+        GLuint catchUpTick;              // GLSL bool
+    };
+
+    static_assert(sizeof(SimulationParameters) == 976, "SimulationParameters must match the std140 layout");
+
+    // Bounce response against the scene depth buffer
+    struct DepthCollisionSettings
+    {
+        float restitution = 0.3f;   // fraction of the normal speed kept on bounce
+        float friction = 0.2f;      // fraction of the tangential speed lost on bounce
+        float thickness = 0.5f;     // world units behind a surface still treated as inside it
+    };
+
+    // Ribbons drawn behind each particle from the positions of its last ticks
+    struct TrailSettings
+    {
+        int length = 16;        // points per ribbon including the particle, at most maxTrailLength
+        float width = 0.2f;     // world units at the particle, tapering to zero at the tail
+    };
+
+    // Keeps the ribbon's per-vertex history search short
+    constexpr int maxTrailLength = 64;
+
+    // Stops simulating a system that stays out of view and fast-forwards it when it returns
+    struct SleepSettings
+    {
+        float particleReach = 2.0f;     // world units a particle travels from its emitter, padding the bounds
+        int framesBeforeSleep = 30;     // consecutive updates out of view before the simulation stops
+    };
+
+    // Simulated at load time so a system starts at steady state instead of respawning all at once
+    struct PrewarmSettings
+    {
+        float duration = 0.0f;  // seconds; 0 starts with an empty pool
+        int steps = 8;          // coarse ticks covering the last maxLifetime seconds of it
     };
 
     class ParticleSimulation
     {
     public:
-        ParticleSimulation(int maxParticles,
-            const glm::vec3& emitterLocation,
-            int totalFrames,
-            glm::ivec2 gridSize,
-            float frameRate,
-            float maxParticleLifetime,
-            float sphereRadius, 
-            const std::string& texturePath);
+        // All emitters added to the simulation share one pool of maxParticles particles
+        explicit ParticleSimulation(int maxParticles, ParticleLayout layout = ParticleLayout::AoS);
         
         ~ParticleSimulation();
+
+        // Emitters must be added before init(); returns the emitter id
+        int addEmitter(const EmitterSettings& settings);
+
+        // Vector fields are loaded in init(); returns the field id, or -1 past maxVectorFields
+        int addVectorField(const VectorFieldSettings& settings);
     
         void init();
+
+        // Advances the simulation by whole fixed ticks; leftover time is used to interpolate the render
         void update(double deltaTime);
+        void setTickRate(double ticksPerSecond, int maxSubstepsPerUpdate = 4);
+
+        // A paused system dispatches and uploads nothing in update() and keeps drawing its last state
+        void setPaused(bool bPaused);
+        bool isPaused() const;
+
+        // Scales the time update() feeds the simulation; 0 freezes it at no cost, like a pause
+        void setTimeScale(float scale);
+        float getTimeScale() const;
+
+        // Advances a paused system by one tick on the next update()
+        void stepTick();
+
+        // Share of every emitter's spawn rate that is used, for trading particle count for GPU
+        // time; the live count follows within one particle lifetime. See FrameBudgetGovernor.
+        void setQualityScale(float scale);
+        float getQualityScale() const;
+
+        // Longest lifetime any emitter gives its particles, in simulation seconds
+        float getMaxParticleLifetime() const;
+
+        // Tests the particle bounds against the camera of the last render(). Out of view, the
+        // draw is skipped, and after framesBeforeSleep updates so is the simulation. On waking,
+        // one coarse tick covers the time slept.
+        void enableOffscreenSleep(const SleepSettings& settings);
+        bool isSleeping() const;
+
+        // Must be set before init(), which runs the prewarm after creating the particles
+        void setPrewarm(const PrewarmSettings& settings);
+
+        // Call before init(). Recording logs the emitter seeds and then every update delta, render
+        // camera and parameter call below; replaying feeds them back in place of the live ones,
+        // which are ignored until the recording runs out. The caller must make the same calls
+        // before init() in both runs. Only the depth and heightfield texture handles are not
+        // recorded: those of the live setDepthCollision and setHeightfield calls are used.
+        bool startRecording(const std::string& path);
+        bool startReplay(const std::string& path);
+        bool isReplaying() const;
+
         static void beginBlend();
         static void endBlend();
         void render(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix);
 
-        void PauseSim();
+        void setEmission(int emitterId, const EmissionSettings& settings);
+        void destroyEmitter(int emitterId);
+
+        // Replaces an emitter's trajectory; after init() this re-uploads the path tables
+        void setEmitterPath(int emitterId, const EmitterPath& path);
+
+        // Rebakes the curl-noise volume if the noise itself changed
+        void setTurbulence(const TurbulenceSettings& settings);
+
+        void setVectorFieldTransform(int fieldId, const glm::mat4& transform);
+
+        // Collides particles with a depth texture rendered with these matrices, normals are
+        // reconstructed from the depth. Call whenever the camera moves; 0 turns collision off.
+        void setDepthCollision(GLuint depthTexture, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix,
+            const DepthCollisionSettings& settings = DepthCollisionSettings());
+
+        // Colliders can be added, changed and cleared at any time; uploads happen on the next tick
+        int addCollider(const ColliderData& collider);
+        void setCollider(int colliderId, const ColliderData& collider);
+        void clearColliders();
+
+        // Forces are applied in the order added; uploads happen on the next tick
+        int addForce(const ForceData& force);
+        void setForce(int forceId, const ForceData& force);
+        void clearForces();
+
+        // Heights in the red channel of a caller-owned texture spanning size (x, z) from origin; 0 turns it off
+        void setHeightfield(GLuint texture, const glm::vec3& origin, const glm::vec2& size, float heightScale,
+            const ColliderResponse& response = ColliderResponse());
+
+        // Builds a spatial grid every tick and pushes crowded particles apart; call before init()
+        void enableDensityRepulsion(const DensitySettings& settings);
+
+        // Records every particle's recent positions and draws them as ribbons; call before init().
+        // Costs 16 bytes per particle per trail point, so only systems that call this pay for it.
+        void enableTrails(const TrailSettings& settings);
+
+        ParticleLayout getLayout() const;
+
+        // Reads the alive count back from the GPU; stalls, so for benchmarks and tools only
+        GLuint readAliveCount() const;
+
+        // Bytes the update and render passes move for aliveCount particles in this layout
+        FrameTraffic estimateFrameTraffic(GLuint aliveCount) const;
 
         void cleanup();
         void destroy();
     
     private:
         void createParticles();
+
+        // Particle storage for the selected layout: one array, or one range per stream
+        std::string layoutDefines() const;
+        std::string trailDefines() const;
+        GLsizeiptr particleBufferSize(int capacity) const;
+        void bindParticleStreams(GLuint buffer, int capacity, unsigned streams, bool bOutput = false) const;
+        void uploadParticles(GLuint buffer, const std::vector<Particle>& particles) const;
+        void createSpriteSheets();
+        void createEmitterPaths();
+        void createTurbulenceField();
+        void createVectorFields();
+
+        // Copy settings into the parameter block; tick() and render() upload whatever changed
+        void writeTurbulenceParameters();
+        void writeVectorFieldParameters();
+        void writeDensityParameters();
+        void writeDepthCollisionParameters();
+        void setDepthCollisionTexture(GLuint depthTexture);
+        void writeHeightfieldParameters();
+        void writeTrailParameters();
+        void uploadColliders();
+        void uploadForces();
+
+        // Uploads a table into an SSBO, reallocating only when it outgrows the buffer
+        static void uploadTable(GLuint& buffer, size_t& bufferSize, const void* data, size_t size);
+
+        // Picks the update kernel's workgroup size and staging mode, from the cache or by autotuning
+        void selectUpdateKernel();
+        // False if there was nothing to tune with, leaving the default variant
+        bool autotuneUpdateKernel();
+        // Defines of the enabled update kernel features, shared by tuning and the real kernel
+        std::string updateKernelFeatureDefines() const;
+        void tick(double deltaTime, bool bCatchUp = false);
+        // The turbulence, vector-field, depth and heightfield textures the update kernel samples
+        void bindUpdateTextures() const;
+
+        // Emitter paths padded by the particle reach, for the off-screen test
+        void updateBounds();
+
+        // Advances the emitter clocks past anything older than the longest lifetime, then covers
+        // the rest in steps coarse ticks and makes the result the drawn state
+        void fastForward(double duration, int steps, bool bCatchUp);
+
+        // Applies recorded calls up to the next until event, leaving its payload to be read
+        void replayUntil(InputEvent until);
+        // False for the caller's own calls while a replay drives the simulation
+        bool acceptsInput() const;
     
         int maxParticles;
-        GLuint particleBuffer;
+        ParticleLayout layout;
+
+        // The next tick reads currentStateSet and writes the other one
+        ParticleStateSet stateSets[2];
+        int currentStateSet;
+        int renderStateSet;    // the set the last tick read, drawn without waiting on that tick
+
+        // Free slots, shared by both state sets, and the atomic counters
+        GLuint deadListBuffer;
+        GLuint counterBuffer;
+
+        // Emitter table
+        GLuint emitterBuffer;
+
         GLuint renderVAO;
         GLuint billboardVBO;
     
         GLuint renderProgram;
         GLuint computeProgram;
+        GLuint indirectArgsProgram;
+        GLuint spawnProgram;
+        GLuint emitterMotionProgram;
+
+        // Trail history and the ribbon pass, only created when trails are enabled. The history
+        // is shared by both state sets: the ribbons read entries older than the tick being run.
+        TrailSettings trails;
+        bool bTrails;
+        GLuint trailHistoryBuffer;
+        GLuint ribbonProgram;
+        GLuint ribbonVAO;
+
+        KernelAutotuner::KernelVariant updateKernelVariant;
+        static constexpr int spawnWorkGroupSize = 64;
+        static constexpr int emitterMotionWorkGroupSize = 64;
+
+        // Particles in the synthetic workload the autotuner times; with trails, fewer, so the
+        // history it writes stays within autotuneTrailBytes
+        static constexpr int autotuneParticles = 1 << 20;
+        static constexpr size_t autotuneTrailBytes = 64 << 20;
+
+        // Shared memory of the workgroup culling in compute.glsl: bounds, then MAX_GROUP_COLLIDERS and MAX_GROUP_FORCES lists
+        static constexpr size_t cullingSharedBytes = (3 + 3 + (1 + 64) + (1 + 32)) * sizeof(GLuint);
+
+        std::vector<ParticleEmitter> emitters;
+        std::vector<EmitterData> emitterData;
+
+        // Emitter trajectories and the keys of the keyed ones, evaluated on the GPU every tick
+        GLuint emitterPathBuffer;
+        GLuint emitterPathKeyBuffer;
+
+        // The only per-emitter data uploaded every tick
+        std::vector<GLuint> emitterSpawnCounts;
+        GLuint emitterSpawnCountBuffer;
+
+        // One layer per distinct sprite sheet, shared by all emitters
+        GLuint spriteSheetArray;
+        std::vector<std::string> spriteSheetPaths;
+        std::vector<glm::vec2> spriteSheetRegions;
+
+        // Baked curl-noise volume the update kernel samples for turbulence
+        GLuint turbulenceField;
+        TurbulenceSettings turbulence;
+
+        std::vector<VectorFieldSettings> vectorFieldSettings;
+        std::vector<glm::mat4> vectorFieldLocalToVolumes;
+        std::vector<GLuint> vectorFieldTextures;
+
+        // Neighbour structure for particle-particle effects, only built when one is enabled
+        SpatialGrid spatialGrid;
+        DensitySettings density;
+        bool bDensityRepulsion;
+
+        // Scene depth the update kernel collides against (texture unit 5), owned by the caller
+        GLuint depthCollisionTexture;
+        glm::mat4 depthViewProjection;
+        glm::vec3 depthCameraPosition;
+        glm::vec2 depthTexelSize;
+        DepthCollisionSettings depthCollision;
+
+        // Analytic colliders, re-uploaded when changed
+        std::vector<ColliderData> colliders;
+        GLuint colliderBuffer;
+        size_t colliderBufferSize;
+        bool bCollidersDirty;
+
+        // Force list, re-uploaded when changed
+        std::vector<ForceData> forces;
+        GLuint forceBuffer;
+        size_t forceBufferSize;
+        bool bForcesDirty;
+
+        // Heightfield (texture unit 6), owned by the caller
+        GLuint heightfieldTexture;
+        glm::vec3 heightfieldOrigin;
+        glm::vec2 heightfieldSize;
+        float heightfieldScale;
+        ColliderResponse heightfieldResponse;
     
-        GLuint smokeTexture;
-    
-        // Uniform locations
-        GLuint viewProjMatrixLocation;
-        GLuint deltaTimeLocation;
-        GLuint viewMatrixLocation;
+        // Per-system parameters of every program, one std140 block
+        UniformBuffer<SimulationParameters> parameters;
     
         // Random number generator
         std::mt19937 rng;
         std::uniform_real_distribution<float> dist;
 
-        glm::vec3 previousEmitterLocation;
-        glm::vec3 currentEmitterLocation;
+        // Frame key for the counter-based RNG in random.glsl; seeds are per emitter
+        GLuint frameIndex;
+
+        // Fixed-tick scheduling
+        double tickRate;
+        int maxSubsteps;
+        double tickAccumulator;
+        double simulationTime;
+        float interpolationAlpha;
 
         bool bPause;
+        float timeScale;
+        int pendingSteps;
+        float qualityScale;
+
+        // Off-screen sleep
+        SleepSettings sleep;
+        bool bSleepEnabled;
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        glm::mat4 lastViewProjection;
+        bool bRendered;
+        int framesOutOfView;
+        double sleptTime;
+
+        PrewarmSettings prewarm;
 
-    protected:
-        std::string texturePath;
-        glm::ivec2 gridSize;
-        float frameRate;
-        float maxParticleLifetime;
-        float sphereRadius;
-        int totalFrames;
+        InputRecording recording;
+        bool bApplyingReplay;
     };
 }
@@ -0,0 +1,124 @@
+#include "SpatialGrid.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#include "ParticleSystem.h"
+#include "../utilities/ShaderUtils.h"
+#include "../Config.h"
+
+particle_simulation::SpatialGrid::SpatialGrid(const SpatialGridSettings& settings) :
+    settings(settings),
+    cellBuffer(0),
+    sortedParticleBuffer(0),
+    particleCellBuffer(0),
+    blockSumBuffer(0),
+    histogramProgram(0),
+    scanPrograms{0, 0, 0},
+    scatterProgram(0)
+{
+    // The scan handles whole blocks and a single block of block totals
+    int cellCount = scanBlockSize;
+    while (cellCount < this->settings.cellCount && cellCount < scanBlockSize * scanBlockSize)
+    {
+        cellCount *= 2;
+    }
+
+    this->settings.cellCount = cellCount;
+    this->settings.cellSize = std::max(this->settings.cellSize, 1e-4f);
+}
+
+void particle_simulation::SpatialGrid::init(int maxParticles, int workGroupSize, const std::string& layoutDefines)
+{
+    const std::string workGroupDefine = "#define WORK_GROUP_SIZE " + std::to_string(workGroupSize) + "\n" + layoutDefines;
+
+    histogramProgram = ShaderUtils::loadComputeShader(std::string(SHADER_PATH) + "/grid_histogram.glsl", workGroupDefine + defines());
+    scatterProgram = ShaderUtils::loadComputeShader(std::string(SHADER_PATH) + "/grid_scatter.glsl", workGroupDefine + defines());
+
+    for (int pass = 0; pass < 3; pass++)
+    {
+        scanPrograms[pass] = ShaderUtils::loadComputeShader(std::string(SHADER_PATH) + "/grid_scan.glsl",
+            "#define SCAN_PASS " + std::to_string(pass) + "\n" + defines());
+    }
+
+    glGenBuffers(1, &cellBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, cellBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, settings.cellCount * sizeof(glm::uvec2), nullptr, GL_DYNAMIC_DRAW);
+
+    glGenBuffers(1, &sortedParticleBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, sortedParticleBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, maxParticles * sizeof(glm::uvec4), nullptr, GL_DYNAMIC_DRAW);
+
+    glGenBuffers(1, &particleCellBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, particleCellBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, maxParticles * sizeof(glm::uvec2), nullptr, GL_DYNAMIC_DRAW);
+
+    glGenBuffers(1, &blockSumBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, blockSumBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, scanBlockSize * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+}
+
+void particle_simulation::SpatialGrid::build(GLuint indirectBuffer)
+{
+    const GLuint scanBlocks = static_cast<GLuint>(settings.cellCount / scanBlockSize);
+
+    bind();
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::gridParticleCells, particleCellBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::gridBlockSums, blockSumBuffer);
+
+    // Empty every cell
+    const GLuint zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, cellBuffer);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+    // Count the particles in each cell, remembering each one's rank within its cell
+    glUseProgram(histogramProgram);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, indirectBuffer);
+    glDispatchComputeIndirect(offsetof(IndirectArgs, dispatchX));
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // Exclusive prefix sum of the counts: per block, over the block totals, then add them back
+    glUseProgram(scanPrograms[0]);
+    glDispatchCompute(scanBlocks, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glUseProgram(scanPrograms[1]);
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glUseProgram(scanPrograms[2]);
+    glDispatchCompute(scanBlocks, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // Each particle lands at its cell's start plus its rank; no second round of atomics
+    glUseProgram(scatterProgram);
+    glDispatchComputeIndirect(offsetof(IndirectArgs, dispatchX));
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void particle_simulation::SpatialGrid::bind() const
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::gridCells, cellBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::gridSortedParticles, sortedParticleBuffer);
+}
+
+std::string particle_simulation::SpatialGrid::defines() const
+{
+    return "#define GRID_CELL_SIZE " + std::to_string(settings.cellSize) + "\n" +
+        "#define GRID_CELL_COUNT " + std::to_string(settings.cellCount) + "\n";
+}
+
+void particle_simulation::SpatialGrid::cleanup()
+{
+    // Zeroed once deleted, so a second cleanup() frees nothing that has since reused the name
+    for (GLuint* buffer : { &cellBuffer, &sortedParticleBuffer, &particleCellBuffer, &blockSumBuffer })
+    {
+        glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    ShaderUtils::deleteProgram(histogramProgram);
+    ShaderUtils::deleteProgram(scanPrograms[0]);
+    ShaderUtils::deleteProgram(scanPrograms[1]);
+    ShaderUtils::deleteProgram(scanPrograms[2]);
+    ShaderUtils::deleteProgram(scatterProgram);
+}
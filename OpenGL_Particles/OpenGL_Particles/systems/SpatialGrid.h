@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include "../glad/glad.h"
+
+namespace particle_simulation
+{
+    struct SpatialGridSettings
+    {
+        float cellSize = 0.25f;     // world units; queries look one cell around, so this bounds the query radius
+        int cellCount = 1 << 18;    // hash buckets, rounded to a power of two the scan can handle
+    };
+
+    // Smoke density repulsion, the first user of the grid
+    struct DensitySettings
+    {
+        SpatialGridSettings grid;
+        float radius = 0.2f;        // neighbours closer than this push apart; at most grid.cellSize
+        float strength = 0.5f;      // acceleration at zero distance
+        int maxNeighbours = 64;     // neighbours inspected per particle, bounding the cost in dense regions
+    };
+
+    // Hashed uniform grid rebuilt every tick with a counting sort: cell histogram, two-level
+    // prefix sum, then a scatter of the alive particles into cell order. Kernels that include
+    // grid.glsl read a cell's particles as one contiguous run of gridSortedParticles.
+    class SpatialGrid
+    {
+    public:
+        // Must match SCAN_BLOCK_SIZE in grid_scan.glsl
+        static constexpr int scanBlockSize = 1024;
+
+        explicit SpatialGrid(const SpatialGridSettings& settings = SpatialGridSettings());
+
+        // workGroupSize must match the indirect dispatch arguments build() is given;
+        // layoutDefines selects the particle storage layout the kernels read positions from
+        void init(int maxParticles, int workGroupSize, const std::string& layoutDefines);
+
+        // Sorts the particles in the alive list bound as AliveListIn. Expects the particle positions
+        // and counter buffers to be bound, and the indirect arguments sized for workGroupSize.
+        void build(GLuint indirectBuffer);
+
+        // Binds the cell table and sorted particles for kernels that query the grid
+        void bind() const;
+
+        // GRID_CELL_SIZE / GRID_CELL_COUNT for kernels that include grid.glsl
+        std::string defines() const;
+        int getCellCount() const { return settings.cellCount; }
+
+        void cleanup();
+
+    private:
+        SpatialGridSettings settings;
+
+        GLuint cellBuffer;              // uvec2 per cell: first sorted slot, particle count
+        GLuint sortedParticleBuffer;    // uvec4 per particle in cell order: xyz = position bits, w = slot
+        GLuint particleCellBuffer;      // uvec2 per alive list entry: cell, rank within the cell
+        GLuint blockSumBuffer;          // per-block totals for the second scan level
+
+        GLuint histogramProgram;
+        GLuint scanPrograms[3];
+        GLuint scatterProgram;
+    };
+}
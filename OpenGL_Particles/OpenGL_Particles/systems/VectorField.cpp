@@ -0,0 +1,157 @@
+#include "VectorField.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <gtc/matrix_transform.hpp>
+
+namespace
+{
+    bool resolutionInRange(const glm::ivec3& resolution)
+    {
+        return resolution.x > 0 && resolution.y > 0 && resolution.z > 0 &&
+            resolution.x <= particle_simulation::maxVectorFieldResolution &&
+            resolution.y <= particle_simulation::maxVectorFieldResolution &&
+            resolution.z <= particle_simulation::maxVectorFieldResolution;
+    }
+}
+
+bool particle_simulation::VectorFieldVolume::isValid() const
+{
+    return resolution.x > 0 && resolution.y > 0 && resolution.z > 0 &&
+        vectors.size() == static_cast<size_t>(resolution.x) * resolution.y * resolution.z &&
+        boundsMax.x > boundsMin.x && boundsMax.y > boundsMin.y && boundsMax.z > boundsMin.z;
+}
+
+bool particle_simulation::parseVectorFieldFGA(std::istream& stream, VectorFieldVolume& volume)
+{
+    // Separators are commas and/or whitespace, so read it back as a stream of numbers
+    std::string text((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    std::replace(text.begin(), text.end(), ',', ' ');
+    std::istringstream numbers(text);
+
+    VectorFieldVolume parsed;
+    if (!(numbers >> parsed.resolution.x >> parsed.resolution.y >> parsed.resolution.z))
+    {
+        std::cerr << "Vector field is missing its resolution" << std::endl;
+        return false;
+    }
+
+    if (!(numbers >> parsed.boundsMin.x >> parsed.boundsMin.y >> parsed.boundsMin.z >>
+        parsed.boundsMax.x >> parsed.boundsMax.y >> parsed.boundsMax.z))
+    {
+        std::cerr << "Vector field is missing its bounds" << std::endl;
+        return false;
+    }
+
+    if (!resolutionInRange(parsed.resolution))
+    {
+        std::cerr << "Vector field has an invalid resolution" << std::endl;
+        return false;
+    }
+
+    // Grown as voxels are read, so a truncated file costs no more memory than its text
+    const size_t voxelCount = static_cast<size_t>(parsed.resolution.x) * parsed.resolution.y * parsed.resolution.z;
+    parsed.vectors.reserve(std::min(voxelCount, text.size() / 6));
+
+    while (parsed.vectors.size() < voxelCount)
+    {
+        glm::vec3 vector;
+        if (!(numbers >> vector.x >> vector.y >> vector.z))
+        {
+            std::cerr << "Vector field ends before its " << voxelCount << " voxels" << std::endl;
+            return false;
+        }
+        parsed.vectors.push_back(vector);
+    }
+
+    if (!parsed.isValid())
+    {
+        std::cerr << "Vector field has empty bounds" << std::endl;
+        return false;
+    }
+
+    volume = std::move(parsed);
+    return true;
+}
+
+bool particle_simulation::loadVectorFieldFGA(const std::string& path, VectorFieldVolume& volume)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open vector field: " << path << std::endl;
+        return false;
+    }
+
+    if (!parseVectorFieldFGA(file, volume))
+    {
+        std::cerr << "Failed to parse vector field: " << path << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool particle_simulation::loadVectorFieldRaw(const std::string& path, const glm::ivec3& resolution,
+    const glm::vec3& boundsMin, const glm::vec3& boundsMax, VectorFieldVolume& volume)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open vector field: " << path << std::endl;
+        return false;
+    }
+
+    // Checked against the file size before anything is allocated
+    const size_t voxelCount = resolutionInRange(resolution) ?
+        static_cast<size_t>(resolution.x) * resolution.y * resolution.z : 0;
+    if (voxelCount == 0 || static_cast<size_t>(file.tellg()) < voxelCount * sizeof(glm::vec3))
+    {
+        std::cerr << "Vector field " << path << " does not match its resolution" << std::endl;
+        return false;
+    }
+    file.seekg(0);
+
+    VectorFieldVolume parsed;
+    parsed.resolution = resolution;
+    parsed.boundsMin = boundsMin;
+    parsed.boundsMax = boundsMax;
+    parsed.vectors.resize(voxelCount);
+
+    static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "Raw vector fields are read straight into glm::vec3");
+    file.read(reinterpret_cast<char*>(parsed.vectors.data()), parsed.vectors.size() * sizeof(glm::vec3));
+
+    if (!file || !parsed.isValid())
+    {
+        std::cerr << "Vector field " << path << " does not match its resolution and bounds" << std::endl;
+        return false;
+    }
+
+    volume = std::move(parsed);
+    return true;
+}
+
+bool particle_simulation::loadVectorField(const VectorFieldSettings& settings, VectorFieldVolume& volume)
+{
+    std::string extension = settings.path.substr(std::min(settings.path.find_last_of('.'), settings.path.size()));
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    if (extension == ".fga")
+    {
+        return loadVectorFieldFGA(settings.path, volume);
+    }
+
+    return loadVectorFieldRaw(settings.path, settings.rawResolution, settings.rawBoundsMin, settings.rawBoundsMax, volume);
+}
+
+glm::mat4 particle_simulation::vectorFieldLocalToVolume(const VectorFieldVolume& volume)
+{
+    const glm::vec3 extent = volume.boundsMax - volume.boundsMin;
+
+    glm::mat4 localToVolume = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f) / extent);
+    return glm::translate(localToVolume, -volume.boundsMin);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <istream>
+#include <string>
+#include <vector>
+#include <glm.hpp>
+
+namespace particle_simulation
+{
+    // Per axis; far above anything a 3D texture of vectors is used at, and a bound on what a
+    // malformed header can make the loaders allocate
+    constexpr int maxVectorFieldResolution = 1024;
+
+    // A grid of velocity vectors over an axis-aligned box in the field's local space.
+    // Plain CPU data: loading and parsing need no GL context.
+    struct VectorFieldVolume
+    {
+        glm::ivec3 resolution = glm::ivec3(0);
+        glm::vec3 boundsMin = glm::vec3(-1.0f);
+        glm::vec3 boundsMax = glm::vec3(1.0f);
+        std::vector<glm::vec3> vectors;     // x-fastest, then y, then z
+
+        bool isValid() const;
+    };
+
+    // A field placed in the world and how strongly it acts on particles
+    struct VectorFieldSettings
+    {
+        std::string path;                               // .fga, anything else is read as raw
+        glm::ivec3 rawResolution = glm::ivec3(0);       // raw grids carry no header
+        glm::vec3 rawBoundsMin = glm::vec3(-1.0f);
+        glm::vec3 rawBoundsMax = glm::vec3(1.0f);
+
+        glm::mat4 transform = glm::mat4(1.0f);          // field local space to world
+        float intensity = 1.0f;                         // field vectors as acceleration
+        float tightness = 0.0f;                         // per-second pull of velocity onto the field
+    };
+
+    // FGA text: "resX,resY,resZ, minX,minY,minZ, maxX,maxY,maxZ," then one "x,y,z," per voxel
+    bool parseVectorFieldFGA(std::istream& stream, VectorFieldVolume& volume);
+    bool loadVectorFieldFGA(const std::string& path, VectorFieldVolume& volume);
+
+    // Raw binary: tightly packed little-endian float32 xyz triplets, x-fastest, with no header
+    bool loadVectorFieldRaw(const std::string& path, const glm::ivec3& resolution,
+        const glm::vec3& boundsMin, const glm::vec3& boundsMax, VectorFieldVolume& volume);
+
+    // Picks the loader from the path's extension
+    bool loadVectorField(const VectorFieldSettings& settings, VectorFieldVolume& volume);
+
+    // Maps local-space positions into the [0, 1] texture coordinates of the volume
+    glm::mat4 vectorFieldLocalToVolume(const VectorFieldVolume& volume);
+}
@@ -0,0 +1,162 @@
+#include "KernelAutotuner.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include "ShaderUtils.h"
+
+namespace KernelAutotuner
+{
+    std::string KernelVariant::defines() const
+    {
+        return "#define WORK_GROUP_SIZE " + std::to_string(workGroupSize) + "\n" +
+            "#define USE_SHARED_STAGING " + (sharedStaging ? "1" : "0") + "\n";
+    }
+
+    std::string driverKey()
+    {
+        const char* renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+        const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+
+        return std::string(renderer ? renderer : "unknown") + "|" + (version ? version : "unknown");
+    }
+
+    std::vector<KernelVariant> buildVariantMatrix(const std::vector<int>& workGroupSizes, size_t sharedBytesPerInvocation, size_t sharedBytesPerGroup)
+    {
+        GLint maxInvocations = 0;
+        GLint maxSharedMemory = 0;
+        glGetIntegerv(GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &maxInvocations);
+        glGetIntegerv(GL_MAX_COMPUTE_SHARED_MEMORY_SIZE, &maxSharedMemory);
+
+        std::vector<KernelVariant> variants;
+        for (int workGroupSize : workGroupSizes)
+        {
+            if (workGroupSize > maxInvocations)
+            {
+                continue;
+            }
+
+            variants.push_back({ workGroupSize, false });
+
+            if (workGroupSize * sharedBytesPerInvocation + sharedBytesPerGroup <= static_cast<size_t>(maxSharedMemory))
+            {
+                variants.push_back({ workGroupSize, true });
+            }
+        }
+
+        return variants;
+    }
+
+    KernelVariant tune(const std::vector<KernelVariant>& variants,
+        const std::function<GLuint(const KernelVariant&)>& build,
+        const std::function<void(GLuint, const KernelVariant&)>& dispatch,
+        const std::function<void()>& prepare,
+        int iterations)
+    {
+        KernelVariant best;
+        double bestTime = -1.0;
+
+        std::vector<GLuint> queries(iterations);
+        glGenQueries(iterations, queries.data());
+
+        for (const KernelVariant& variant : variants)
+        {
+            GLuint program = build(variant);
+
+            // Warm up so compilation and first-use costs stay out of the timings
+            prepare();
+            dispatch(program, variant);
+            glFinish();
+
+            for (int i = 0; i < iterations; i++)
+            {
+                prepare();
+                glBeginQuery(GL_TIME_ELAPSED, queries[i]);
+                dispatch(program, variant);
+                glEndQuery(GL_TIME_ELAPSED);
+            }
+
+            std::vector<double> timings(iterations);
+            for (int i = 0; i < iterations; i++)
+            {
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &elapsed);
+                timings[i] = static_cast<double>(elapsed) * 1e-6;
+            }
+
+            std::nth_element(timings.begin(), timings.begin() + iterations / 2, timings.end());
+            const double medianTime = timings[iterations / 2];
+
+            std::cout << "Autotune: local_size_x = " << variant.workGroupSize
+                << (variant.sharedStaging ? ", shared staging" : "")
+                << ": " << medianTime << " ms" << std::endl;
+
+            if (bestTime < 0.0 || medianTime < bestTime)
+            {
+                bestTime = medianTime;
+                best = variant;
+            }
+
+            ShaderUtils::deleteProgram(program);
+        }
+
+        glDeleteQueries(iterations, queries.data());
+
+        return best;
+    }
+
+    bool loadCached(const std::string& cachePath, const std::string& key, KernelVariant& variant)
+    {
+        std::ifstream cacheFile(cachePath);
+        std::string line;
+        while (std::getline(cacheFile, line))
+        {
+            const size_t separator = line.find('\t');
+            if (separator == std::string::npos || line.compare(0, separator, key) != 0 || separator != key.size())
+            {
+                continue;
+            }
+
+            std::istringstream values(line.substr(separator + 1));
+            int sharedStaging = 0;
+            if (values >> variant.workGroupSize >> sharedStaging)
+            {
+                variant.sharedStaging = sharedStaging != 0;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void storeCached(const std::string& cachePath, const std::string& key, const KernelVariant& variant)
+    {
+        // Keep the entries for other drivers and kernels
+        std::vector<std::string> lines;
+        {
+            std::ifstream cacheFile(cachePath);
+            std::string line;
+            while (std::getline(cacheFile, line))
+            {
+                if (line.compare(0, key.size() + 1, key + '\t') != 0)
+                {
+                    lines.push_back(line);
+                }
+            }
+        }
+
+        lines.push_back(key + '\t' + std::to_string(variant.workGroupSize) + '\t' + (variant.sharedStaging ? "1" : "0"));
+
+        std::ofstream cacheFile(cachePath, std::ios::trunc);
+        if (!cacheFile)
+        {
+            std::cerr << "Failed to write kernel cache " << cachePath << std::endl;
+            return;
+        }
+
+        for (const std::string& line : lines)
+        {
+            cacheFile << line << '\n';
+        }
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+#include "../glad/glad.h"
+
+namespace KernelAutotuner
+{
+    // One point in the tuning matrix
+    struct KernelVariant
+    {
+        int workGroupSize = 256;
+        bool sharedStaging = false;
+
+        // "#define" lines selecting this variant, for ShaderUtils::loadComputeShader
+        std::string defines() const;
+    };
+
+    // GL_RENDERER and GL_VERSION; tuning results are only valid for the driver that produced them
+    std::string driverKey();
+
+    // Every size, with and without shared staging, that fits the device's workgroup and shared memory limits.
+    // sharedBytesPerGroup is shared memory the kernel uses regardless of staging.
+    std::vector<KernelVariant> buildVariantMatrix(const std::vector<int>& workGroupSizes, size_t sharedBytesPerInvocation, size_t sharedBytesPerGroup = 0);
+
+    // Builds each variant, times it with GL timer queries and returns the fastest (median of the runs).
+    // build compiles a program for a variant; dispatch binds it and issues one run. prepare restores
+    // the inputs before each run, outside the timed region.
+    KernelVariant tune(const std::vector<KernelVariant>& variants,
+        const std::function<GLuint(const KernelVariant&)>& build,
+        const std::function<void(GLuint, const KernelVariant&)>& dispatch,
+        const std::function<void()>& prepare,
+        int iterations = 8);
+
+    // On-disk cache with one "key<TAB>workGroupSize<TAB>sharedStaging" line per tuned kernel
+    bool loadCached(const std::string& cachePath, const std::string& key, KernelVariant& variant);
+    void storeCached(const std::string& cachePath, const std::string& key, const KernelVariant& variant);
+}
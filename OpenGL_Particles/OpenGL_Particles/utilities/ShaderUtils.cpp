@@ -1,25 +1,125 @@
 #include "ShaderUtils.h"
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    // Defines have to come after the #version line
+    void insertDefines(std::string& source, const std::string& defines)
+    {
+        if (defines.empty())
+        {
+            return;
+        }
+
+        const size_t versionLine = source.find("#version");
+        const size_t insertAt = versionLine == std::string::npos ? 0 : source.find('\n', versionLine) + 1;
+        source.insert(insertAt, defines);
+    }
+
+    // Active uniform locations of every linked program, sorted by name hash
+    using UniformLocations = std::vector<std::pair<uint32_t, GLint>>;
+    std::unordered_map<GLuint, UniformLocations> uniformLocationCache;
+
+    void cacheUniformLocations(GLuint program)
+    {
+        GLint uniformCount = 0;
+        GLint maxNameLength = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+        UniformLocations& locations = uniformLocationCache[program];
+        locations.clear();
+
+        std::string name(std::max(maxNameLength, 1), '\0');
+        for (GLint i = 0; i < uniformCount; i++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(program, static_cast<GLuint>(i), static_cast<GLsizei>(name.size()), &length, &size, &type, &name[0]);
+
+            // Block members have no location of their own
+            const std::string_view uniformName(name.data(), length);
+            const GLint location = glGetUniformLocation(program, name.c_str());
+            if (location == -1)
+            {
+                continue;
+            }
+
+            // Arrays are reported as "name[0]"; register every element, and the bare name for element 0
+            const size_t bracket = uniformName.find('[');
+            const std::string_view baseName = uniformName.substr(0, bracket);
+            locations.emplace_back(ShaderUtils::hashUniformName(baseName), location);
+            if (bracket != std::string_view::npos)
+            {
+                for (GLint element = 0; element < size; element++)
+                {
+                    const std::string elementName = std::string(baseName) + "[" + std::to_string(element) + "]";
+                    locations.emplace_back(ShaderUtils::hashUniformName(elementName), location + element);
+                }
+            }
+        }
+
+        std::sort(locations.begin(), locations.end());
+
+        const auto collision = std::adjacent_find(locations.begin(), locations.end(),
+            [](const auto& a, const auto& b) { return a.first == b.first; });
+        if (collision != locations.end())
+        {
+            std::cerr << "WARNING::SHADER::UNIFORM_HASH_COLLISION in program " << program << std::endl;
+        }
+    }
+}
 
 namespace ShaderUtils
 {
-    GLuint loadShader(const std::string& vertexPath, const std::string& fragmentPath)
+    std::string readShaderSource(const std::string& path)
+    {
+        std::ifstream shaderFile(path);
+        if (!shaderFile)
+        {
+            std::cerr << "ERROR::SHADER::FILE_NOT_FOUND\n" << path << std::endl;
+            return {};
+        }
+
+        // Includes are resolved relative to the including file
+        const std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+
+        std::stringstream source;
+        std::string line;
+        while (std::getline(shaderFile, line))
+        {
+            const size_t directive = line.find("#include");
+            if (directive != std::string::npos && line.find_first_not_of(" \t") == directive)
+            {
+                const size_t open = line.find('"', directive);
+                const size_t close = line.find('"', open + 1);
+                if (open != std::string::npos && close != std::string::npos)
+                {
+                    source << readShaderSource(directory + line.substr(open + 1, close - open - 1)) << '\n';
+                    continue;
+                }
+            }
+
+            source << line << '\n';
+        }
+
+        return source.str();
+    }
+
+    GLuint loadShader(const std::string& vertexPath, const std::string& fragmentPath, const std::string& defines)
     {
-        // Read vertex shader code
-        std::string vertexCode;
-        std::ifstream vShaderFile(vertexPath);
-        std::stringstream vShaderStream;
-        vShaderStream << vShaderFile.rdbuf();
-        vertexCode = vShaderStream.str();
-
-        // Read fragment shader code
-        std::string fragmentCode;
-        std::ifstream fShaderFile(fragmentPath);
-        std::stringstream fShaderStream;
-        fShaderStream << fShaderFile.rdbuf();
-        fragmentCode = fShaderStream.str();
+        // Read vertex and fragment shader code
+        std::string vertexCode = readShaderSource(vertexPath);
+        std::string fragmentCode = readShaderSource(fragmentPath);
+        insertDefines(vertexCode, defines);
+        insertDefines(fragmentCode, defines);
 
         // Compile shaders
         const char* vShaderCode = vertexCode.c_str();
@@ -60,19 +160,18 @@ namespace ShaderUtils
             std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
         }
 
+        cacheUniformLocations(program);
+
         glDeleteShader(vertex);
         glDeleteShader(fragment);
 
         return program;
     }
 
-    GLuint loadComputeShader(const std::string& computePath)
+    GLuint loadComputeShader(const std::string& computePath, const std::string& defines)
     {
-        std::string computeCode;
-        std::ifstream cShaderFile(computePath);
-        std::stringstream cShaderStream;
-        cShaderStream << cShaderFile.rdbuf();
-        computeCode = cShaderStream.str();
+        std::string computeCode = readShaderSource(computePath);
+        insertDefines(computeCode, defines);
 
         const char* cShaderCode = computeCode.c_str();
 
@@ -100,53 +199,107 @@ namespace ShaderUtils
             std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
         }
 
+        cacheUniformLocations(program);
+
         glDeleteShader(compute);
 
         return program;
     }
 
-    void setUniformMat4(GLuint program, const std::string& name, const glm::mat4& matrix)
+    GLint getUniformLocation(GLuint program, UniformName name)
+    {
+        const auto cached = uniformLocationCache.find(program);
+        if (cached == uniformLocationCache.end())
+        {
+            return -1;
+        }
+
+        const UniformLocations& locations = cached->second;
+        const auto it = std::lower_bound(locations.begin(), locations.end(), std::make_pair(name.hash, GLint(-1)));
+        return it != locations.end() && it->first == name.hash ? it->second : -1;
+    }
+
+    void deleteProgram(GLuint& program)
     {
-        GLuint location = glGetUniformLocation(program, name.c_str());
+        if (program == 0)
+        {
+            return;
+        }
+
+        uniformLocationCache.erase(program);
+        glDeleteProgram(program);
+        program = 0;
+    }
+
+    void setUniformMat4(GLuint program, UniformName name, const glm::mat4& matrix)
+    {
+        const GLint location = getUniformLocation(program, name);
         if (location != -1)
         {
             glUniformMatrix4fv(location, 1, GL_FALSE, &matrix[0][0]);
         }
     }
 
-    void setUniformIVec2(GLuint program, const std::string& name, const glm::ivec2& vector)
+    void setUniformMat3(GLuint program, UniformName name, const glm::mat3& matrix)
+    {
+        const GLint location = getUniformLocation(program, name);
+        if (location != -1)
+        {
+            glUniformMatrix3fv(location, 1, GL_FALSE, &matrix[0][0]);
+        }
+    }
+
+    void setUniformVec2(GLuint program, UniformName name, const glm::vec2& vector)
+    {
+        const GLint location = getUniformLocation(program, name);
+        if (location != -1)
+        {
+            glUniform2fv(location, 1, &vector[0]);
+        }
+    }
+
+    void setUniformIVec2(GLuint program, UniformName name, const glm::ivec2& vector)
     {
-        GLuint location = glGetUniformLocation(program, name.c_str());
+        const GLint location = getUniformLocation(program, name);
         if (location != -1)
         {
             glUniform2i(location, vector.x, vector.y);
         }
     }
 
-    void setUniformVec3(GLuint program, const std::string& name, const glm::vec3& vector)
+    void setUniformVec3(GLuint program, UniformName name, const glm::vec3& vector)
     {
-        GLuint location = glGetUniformLocation(program, name.c_str());
+        const GLint location = getUniformLocation(program, name);
         if (location != -1)
         {
             glUniform3fv(location, 1, &vector[0]);
         }
     }
 
-    void setUniformFloat(GLuint program, const std::string& name, float value)
+    void setUniformFloat(GLuint program, UniformName name, float value)
     {
-        GLuint location = glGetUniformLocation(program, name.c_str());
+        const GLint location = getUniformLocation(program, name);
         if (location != -1)
         {
             glUniform1f(location, value);
         }
     }
 
-    void setUniformInt(GLuint program, const std::string& name, int value)
+    void setUniformInt(GLuint program, UniformName name, int value)
     {
-        GLuint location = glGetUniformLocation(program, name.c_str());
+        const GLint location = getUniformLocation(program, name);
         if (location != -1)
         {
             glUniform1i(location, value);
         }
     }
+
+    void setUniformUInt(GLuint program, UniformName name, GLuint value)
+    {
+        const GLint location = getUniformLocation(program, name);
+        if (location != -1)
+        {
+            glUniform1ui(location, value);
+        }
+    }
 }
@@ -1,15 +1,52 @@
 #pragma once
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <glm.hpp>
 #include "../glad/glad.h"
 
 namespace ShaderUtils
 {
-    GLuint loadShader(const std::string& vertexPath, const std::string& fragmentPath);
-    GLuint loadComputeShader(const std::string& computePath);
-    void setUniformMat4(GLuint program, const std::string& name, const glm::mat4& matrix);
-    void setUniformIVec2(GLuint program, const std::string& name, const glm::ivec2& vector);
-    void setUniformVec3(GLuint program, const std::string& name, const glm::vec3& vector);
-    void setUniformFloat(GLuint program, const std::string& name, float value);
-    void setUniformInt(GLuint program, const std::string& name, int value);
+    // Reads a shader file, expanding #include "file" lines relative to it
+    std::string readShaderSource(const std::string& path);
+    // defines are "#define NAME VALUE" lines inserted after #version, for building shader variants
+    GLuint loadShader(const std::string& vertexPath, const std::string& fragmentPath, const std::string& defines = "");
+    GLuint loadComputeShader(const std::string& computePath, const std::string& defines = "");
+
+    // Uniform locations are cached per program when it links, keyed by the FNV-1a hash of the
+    // name, so setting a uniform is a lookup with no string building or driver round trip
+    constexpr uint32_t hashUniformName(std::string_view name)
+    {
+        uint32_t hash = 2166136261u;
+        for (char c : name)
+        {
+            hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+        }
+        return hash;
+    }
+
+    // A uniform name with its hash; declare these constexpr to hash at compile time
+    struct UniformName
+    {
+        constexpr UniformName(std::string_view name) : hash(hashUniformName(name)) {}
+        constexpr UniformName(const char* name) : UniformName(std::string_view(name)) {}
+
+        uint32_t hash;
+    };
+
+    // -1 when the uniform is not active in the program; array elements are "name[i]"
+    GLint getUniformLocation(GLuint program, UniformName name);
+
+    // Deletes the program, forgets its cached locations and zeroes the handle; 0 is a no-op,
+    // so deleting twice can't drop the cache of a program that reused the name
+    void deleteProgram(GLuint& program);
+
+    void setUniformMat4(GLuint program, UniformName name, const glm::mat4& matrix);
+    void setUniformMat3(GLuint program, UniformName name, const glm::mat3& matrix);
+    void setUniformVec2(GLuint program, UniformName name, const glm::vec2& vector);
+    void setUniformIVec2(GLuint program, UniformName name, const glm::ivec2& vector);
+    void setUniformVec3(GLuint program, UniformName name, const glm::vec3& vector);
+    void setUniformFloat(GLuint program, UniformName name, float value);
+    void setUniformInt(GLuint program, UniformName name, int value);
+    void setUniformUInt(GLuint program, UniformName name, GLuint value);
 } 
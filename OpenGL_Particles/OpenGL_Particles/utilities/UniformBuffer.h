@@ -0,0 +1,100 @@
+#pragma once
+#include <cstring>
+#include <type_traits>
+#include "../glad/glad.h"
+
+// A std140 uniform block mirrored by the C++ struct T. Edit the CPU copy freely; upload() compares
+// it with what the GPU last received and sends only the changed byte range, or nothing at all.
+// T must spell out its std140 padding as members so no byte of it is indeterminate.
+template <typename T>
+class UniformBuffer
+{
+    static_assert(std::is_trivially_copyable<T>::value, "UniformBuffer needs a plain struct");
+    static_assert(sizeof(T) % 16 == 0, "std140 blocks are a multiple of 16 bytes");
+
+public:
+    UniformBuffer() :
+        buffer(0),
+        bindingPoint(0),
+        bUploaded(false)
+    {
+        std::memset(static_cast<void*>(&data), 0, sizeof(T));
+        std::memset(static_cast<void*>(&uploadedData), 0, sizeof(T));
+    }
+
+    void init(GLuint binding)
+    {
+        bindingPoint = binding;
+        bUploaded = false;
+
+        if (buffer == 0)
+        {
+            glGenBuffers(1, &buffer);
+        }
+
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(T), nullptr, GL_DYNAMIC_DRAW);
+    }
+
+    T& edit()
+    {
+        return data;
+    }
+
+    const T& get() const
+    {
+        return data;
+    }
+
+    // Returns false when nothing changed since the last upload
+    bool upload()
+    {
+        const unsigned char* current = reinterpret_cast<const unsigned char*>(&data);
+        const unsigned char* uploaded = reinterpret_cast<const unsigned char*>(&uploadedData);
+
+        size_t first = 0;
+        size_t last = sizeof(T);
+        if (bUploaded)
+        {
+            while (first < sizeof(T) && current[first] == uploaded[first])
+            {
+                first++;
+            }
+            if (first == sizeof(T))
+            {
+                return false;
+            }
+            while (current[last - 1] == uploaded[last - 1])
+            {
+                last--;
+            }
+        }
+
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, first, last - first, current + first);
+
+        std::memcpy(static_cast<void*>(&uploadedData), &data, sizeof(T));
+        bUploaded = true;
+        return true;
+    }
+
+    void bind() const
+    {
+        glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, buffer);
+    }
+
+    void cleanup()
+    {
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+        bUploaded = false;
+    }
+
+private:
+    GLuint buffer;
+    GLuint bindingPoint;
+    bool bUploaded;
+
+    T data;
+    T uploadedData;
+};
@@ -0,0 +1,112 @@
+#include <cstdio>
+#include <filesystem>
+
+#include "TestCheck.h"
+#include "../OpenGL_Particles/systems/InputRecording.h"
+
+using namespace particle_simulation;
+
+namespace
+{
+    const char* recordingPath = "InputRecordingTests.rec";
+
+    EmissionSettings twoBursts()
+    {
+        EmissionSettings emission;
+        emission.spawnRate = 50.0f;
+        emission.bursts = { { 0.0f, 10, 1, 0.0f }, { 1.5f, 4, 0, 0.25f } };
+        return emission;
+    }
+
+    // Header with two emitter seeds, then whatever the caller records
+    template <typename... Args>
+    void writeRecording(InputEvent event, const Args&... args)
+    {
+        InputRecording recording;
+        CHECK(recording.startRecording(recordingPath));
+        std::vector<uint32_t> seeds = { 11u, 22u };
+        recording.begin(seeds);
+        recording.record(event, args...);
+        recording.record(InputEvent::Update, 0.25);
+        recording.stop();
+    }
+
+    // Opens the recording and reads up to the first event's payload
+    bool startReplay(InputRecording& recording, InputEvent& event)
+    {
+        std::vector<uint32_t> seeds = { 0u, 0u };
+        if (!recording.startReplay(recordingPath))
+        {
+            return false;
+        }
+
+        recording.begin(seeds);
+        return recording.nextEvent(event);
+    }
+
+    void testRoundTrip()
+    {
+        writeRecording(InputEvent::Emission, static_cast<int32_t>(1), twoBursts());
+
+        InputRecording recording;
+        std::vector<uint32_t> seeds = { 0u, 0u };
+        CHECK(recording.startReplay(recordingPath));
+        recording.begin(seeds);
+        CHECK(seeds[0] == 11u && seeds[1] == 22u);
+
+        InputEvent event;
+        CHECK(recording.nextEvent(event) && event == InputEvent::Emission);
+        CHECK(recording.read<int32_t>() == 1);
+        const EmissionSettings emission = recording.read<EmissionSettings>();
+        CHECK(recording.readComplete());
+        CHECK(emission.spawnRate == 50.0f && emission.bursts.size() == 2);
+        CHECK(emission.bursts[1].cycles == 0 && emission.bursts[1].interval == 0.25f);
+
+        CHECK(recording.nextEvent(event) && event == InputEvent::Update);
+        CHECK(recording.read<double>() == 0.25);
+        CHECK(recording.readComplete());
+        CHECK(!recording.nextEvent(event));
+        CHECK(!recording.isReplaying());
+    }
+
+    // A burst count the rest of the file can't hold stops the replay before allocating
+    void testRejectsHugeCount()
+    {
+        writeRecording(InputEvent::Emission, static_cast<int32_t>(0), 50.0f, static_cast<int32_t>(0), 0xFFFFFFFFu);
+
+        InputRecording recording;
+        InputEvent event;
+        CHECK(startReplay(recording, event) && event == InputEvent::Emission);
+        recording.read<int32_t>();
+        const EmissionSettings emission = recording.read<EmissionSettings>();
+        CHECK(emission.bursts.empty());
+        CHECK(!recording.readComplete());
+        CHECK(!recording.isReplaying());
+    }
+
+    void testRejectsTruncatedEvent()
+    {
+        writeRecording(InputEvent::Emission, static_cast<int32_t>(0), twoBursts());
+
+        // Cut into the second burst, dropping the update after it too
+        const auto size = std::filesystem::file_size(recordingPath);
+        std::filesystem::resize_file(recordingPath, size - sizeof(uint8_t) - sizeof(double) - sizeof(EmissionBurst) / 2);
+
+        InputRecording recording;
+        InputEvent event;
+        CHECK(startReplay(recording, event) && event == InputEvent::Emission);
+        recording.read<int32_t>();
+        recording.read<EmissionSettings>();
+        CHECK(!recording.readComplete());
+        CHECK(!recording.isReplaying());
+    }
+}
+
+int main()
+{
+    testRoundTrip();
+    testRejectsHugeCount();
+    testRejectsTruncatedEvent();
+    std::remove(recordingPath);
+    return test::finish("InputRecordingTests");
+}
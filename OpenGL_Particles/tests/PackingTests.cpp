@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <cmath>
+#include <glm.hpp>
+
+#include "TestCheck.h"
+#include "../OpenGL_Particles/systems/ParticlePacking.h"
+
+using namespace particle_simulation;
+
+namespace
+{
+    constexpr float tickSeconds = 1.0f / 60.0f;
+    constexpr int slotCount = 64;
+
+    struct SteppedParticle
+    {
+        Particle exact;     // kept in floats throughout
+        Particle packed;    // packed after every tick, the way the update kernel stores it
+    };
+
+    SteppedParticle makeParticle(int slot, float speed, float lifetime)
+    {
+        Particle particle;
+        particle.position = glm::vec4(static_cast<float>(slot), 1.0f, -2.0f * slot, 0.0f);
+        particle.color = glm::vec4(1.0f);
+        particle.velocity = glm::vec4(speed, 0.0f, 0.0f, lifetime);
+        return { particle, particle };
+    }
+
+    void step(Particle& particle, const glm::vec3& acceleration)
+    {
+        glm::vec3 velocity = glm::vec3(particle.velocity) + acceleration * tickSeconds;
+        particle.position += glm::vec4(velocity * tickSeconds, 0.0f);
+        particle.velocity = glm::vec4(velocity, particle.velocity.w - tickSeconds);
+    }
+
+    void stepPacked(Particle& particle, const glm::vec3& acceleration, uint32_t slot)
+    {
+        step(particle, acceleration);
+        particle = unpackParticle(packParticle(particle, slot));
+    }
+
+    void testStochasticRounding()
+    {
+        // Exact halves are kept, anything else lands on one of its two neighbours
+        const float third = 1.0f / 3.0f;
+        const float below = glm::unpackHalf2x16(packHalfStochastic(third, 0.999f)).x;
+        const float above = glm::unpackHalf2x16(packHalfStochastic(third, 0.0f)).x;
+        CHECK(glm::unpackHalf2x16(packHalfStochastic(3.0f, 0.5f)).x == 3.0f);
+        CHECK(below < third && above > third);
+        CHECK(above - below < 0.001f);
+
+        // Negative values step away from zero the same way
+        CHECK(glm::unpackHalf2x16(packHalfStochastic(-third, 0.0f)).x == -above);
+    }
+
+    // 0.05 m/s^2 of wind on a 3 m/s particle for 10 s: each tick adds less than half a ulp
+    void testSmallAccelerationSurvives()
+    {
+        const glm::vec3 wind(0.05f, 0.0f, 0.0f);
+        const int ticks = 600;
+
+        // Round to nearest drops the increment every tick
+        float nearest = 3.0f;
+        for (int tick = 0; tick < ticks; tick++)
+        {
+            nearest = glm::unpackHalf2x16(glm::packHalf2x16(glm::vec2(nearest + wind.x * tickSeconds, 0.0f))).x;
+        }
+        CHECK(nearest == 3.0f);
+
+        double meanSpeed = 0.0;
+        float worstError = 0.0f;
+        for (int slot = 0; slot < slotCount; slot++)
+        {
+            SteppedParticle particle = makeParticle(slot, 3.0f, 20.0f);
+            for (int tick = 0; tick < ticks; tick++)
+            {
+                step(particle.exact, wind);
+                stepPacked(particle.packed, wind, static_cast<uint32_t>(slot));
+            }
+
+            CHECK(std::abs(particle.exact.velocity.x - 3.5f) < 0.001f);
+            worstError = std::max(worstError, std::abs(particle.packed.velocity.x - particle.exact.velocity.x));
+            meanSpeed += particle.packed.velocity.x / slotCount;
+        }
+
+        CHECK(worstError < 0.1f);
+        CHECK(std::abs(meanSpeed - 3.5) < 0.01);
+    }
+
+    // Lifetimes of 10-20 s counted down for 10 s, where the half ulp is larger than a tick's share
+    void testLifetimeUnbiased()
+    {
+        const int ticks = 600;
+
+        for (float lifetime : { 10.5f, 15.0f, 20.0f })
+        {
+            double meanError = 0.0;
+            float worstError = 0.0f;
+            for (int slot = 0; slot < slotCount; slot++)
+            {
+                SteppedParticle particle = makeParticle(slot, 3.0f, lifetime);
+                for (int tick = 0; tick < ticks; tick++)
+                {
+                    step(particle.exact, glm::vec3(0.0f));
+                    stepPacked(particle.packed, glm::vec3(0.0f), static_cast<uint32_t>(slot));
+                }
+
+                const float error = particle.packed.velocity.w - particle.exact.velocity.w;
+                worstError = std::max(worstError, std::abs(error));
+                meanError += error / slotCount;
+            }
+
+            CHECK(worstError < 0.3f);
+            CHECK(std::abs(meanError) < 0.02);
+        }
+    }
+}
+
+int main()
+{
+    testStochasticRounding();
+    testSmallAccelerationSurvives();
+    testLifetimeUnbiased();
+    return test::finish("PackingTests");
+}
@@ -0,0 +1,85 @@
+#include <algorithm>
+
+#include "TestCheck.h"
+#include "../OpenGL_Particles/systems/ParticleEmitter.h"
+
+using namespace particle_simulation;
+
+namespace
+{
+    constexpr double tickRate = 60.0;
+
+    // 1000 particles per second living 4 s, under a budget of 20 per tick: 16.7 are due in a
+    // fixed tick, so the budget only bites on longer ones
+    ParticleEmitter makeEmitter()
+    {
+        EmitterSettings settings;
+        settings.maxParticleLifetime = 4.0f;
+        settings.emission.spawnRate = 1000.0f;
+        settings.emission.maxSpawnPerTick = 20;
+        return ParticleEmitter(settings, 1u);
+    }
+
+    // Spawns of the ticks ParticleSimulation::fastForward runs over the last lifetime, with
+    // the budget scaled as tick() scales it
+    int fastForward(ParticleEmitter& emitter, double duration, int steps)
+    {
+        const double window = std::min(duration, static_cast<double>(emitter.getSettings().maxParticleLifetime));
+        emitter.emit(duration - window);
+
+        int spawned = 0;
+        for (int step = 0; step < steps; step++)
+        {
+            const double deltaTime = window / steps;
+            spawned += emitter.emit(deltaTime, 1.0f, deltaTime * tickRate);
+        }
+        return spawned;
+    }
+
+    void testFixedTicksUseTheBudget()
+    {
+        ParticleEmitter emitter = makeEmitter();
+        EmissionSettings emission = emitter.getSettings().emission;
+        emission.maxSpawnPerTick = 10;
+        emitter.setEmission(emission);
+
+        int spawned = 0;
+        for (int tick = 0; tick < 60; tick++)
+        {
+            const int count = emitter.emit(1.0 / tickRate, 1.0f, 1.0);
+            CHECK(count <= 10);
+            spawned += count;
+        }
+        CHECK(spawned == 600);
+    }
+
+    // Prewarm and wake-up reach the population continuous emission would have left alive
+    void testFastForwardReachesSteadyState()
+    {
+        const int steadyPopulation = 4000;
+
+        ParticleEmitter prewarmed = makeEmitter();
+        CHECK(fastForward(prewarmed, 5.0, 8) == steadyPopulation);
+
+        // Waking from a long sleep is one coarse tick over the whole lifetime
+        ParticleEmitter woken = makeEmitter();
+        CHECK(fastForward(woken, 30.0, 1) == steadyPopulation);
+
+        // With the unscaled budget the prewarm would have stopped at 8 ticks' worth
+        ParticleEmitter unscaled = makeEmitter();
+        unscaled.emit(1.0);
+        int spawned = 0;
+        for (int step = 0; step < 8; step++)
+        {
+            spawned += unscaled.emit(0.5);
+        }
+        CHECK(spawned == 8 * 20);
+    }
+}
+
+int main()
+{
+    testFixedTicksUseTheBudget();
+    testFastForwardReachesSteadyState();
+    return test::finish("ParticleEmitterTests");
+}
@@ -0,0 +1,78 @@
+#include <cmath>
+
+#include "TestCheck.h"
+#include "../OpenGL_Particles/systems/ParticleRandom.h"
+
+using namespace particle_simulation::random;
+
+namespace
+{
+    bool equal(const UInt4& a, const UInt4& b)
+    {
+        return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
+    }
+
+    // Reference outputs of pcg4d as written in shaders/random.glsl
+    void testHashVectors()
+    {
+        CHECK(equal(pcg4d({ 0u, 0u, 0u, 0u }), { 0x0F02F829u, 0x2D568769u, 0x32B0C43Bu, 0xD32548EAu }));
+        CHECK(equal(pcg4d({ 1u, 2u, 3u, 4u }), { 0x3622CD16u, 0xF11471D8u, 0xE1109B3Fu, 0x02B94C2Fu }));
+        CHECK(equal(pcg4d({ 12345u, 678u, 0xDEADBEEFu, 7u }), { 0x6913B26Fu, 0xF546CA11u, 0x66B7D52Au, 0x05B5B89Du }));
+        CHECK(equal(pcg4d({ 0xFFFFFFFFu, 0xFFFFFFFFu, 0xFFFFFFFFu, 0xFFFFFFFFu }), { 0x974ED892u, 0xC015DC67u, 0x9F955760u, 0xA1BBA208u }));
+
+        // Each draw hashes the key, then advances the counter
+        Rng rng = rngCreate(1u, 2u, 3u);
+        rng.key.w = 4u;
+        CHECK(equal(rngNextUint4(rng), { 0x3622CD16u, 0xF11471D8u, 0xE1109B3Fu, 0x02B94C2Fu }));
+        CHECK(rng.key.w == 5u);
+    }
+
+    void testUnitFloatRange()
+    {
+        CHECK(rngToUnitFloat(0u) == 0.0f);
+        CHECK(rngToUnitFloat(0xFFFFFFFFu) < 1.0f);
+        CHECK(rngToUnitFloat(0x80000000u) == 0.5f);
+    }
+
+    // Chi-square over 16 bins of every float a run of spawns would draw
+    void testUnitFloatUniformity()
+    {
+        constexpr int binCount = 16;
+        constexpr int spawnCount = 1 << 14;
+        int bins[binCount] = {};
+        double sum = 0.0;
+        int samples = 0;
+
+        for (uint32_t spawnIndex = 0; spawnIndex < spawnCount; spawnIndex++)
+        {
+            Rng rng = rngCreate(spawnIndex, 17u, 0x9E3779B9u);
+            const Float4 values = rngNextFloat4(rng);
+            for (float value : { values.x, values.y, values.z, values.w })
+            {
+                CHECK(value >= 0.0f && value < 1.0f);
+                bins[static_cast<int>(value * binCount)]++;
+                sum += value;
+                samples++;
+            }
+        }
+
+        const double expected = static_cast<double>(samples) / binCount;
+        double chiSquare = 0.0;
+        for (int count : bins)
+        {
+            chiSquare += (count - expected) * (count - expected) / expected;
+        }
+
+        // 15 degrees of freedom: 37.7 is the 0.1% critical value
+        CHECK(chiSquare < 37.7);
+        CHECK(std::abs(sum / samples - 0.5) < 0.005);
+    }
+}
+
+int main()
+{
+    testHashVectors();
+    testUnitFloatRange();
+    testUnitFloatUniformity();
+    return test::finish("RandomTests");
+}
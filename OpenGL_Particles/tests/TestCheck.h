@@ -0,0 +1,31 @@
+#pragma once
+
+#include <iostream>
+
+// Minimal checks for the CPU-side tests: every failed CHECK is printed, and the test's main
+// returns nonzero if any failed, which is all ctest needs
+namespace test
+{
+    inline int& failureCount()
+    {
+        static int count = 0;
+        return count;
+    }
+
+    inline void check(bool bPassed, const char* condition, const char* file, int line)
+    {
+        if (!bPassed)
+        {
+            std::cerr << file << ":" << line << ": CHECK(" << condition << ") failed" << std::endl;
+            failureCount()++;
+        }
+    }
+
+    inline int finish(const char* testName)
+    {
+        std::cout << testName << ": " << (failureCount() == 0 ? "passed" : "FAILED") << std::endl;
+        return failureCount() == 0 ? 0 : 1;
+    }
+}
+
+#define CHECK(condition) test::check((condition), #condition, __FILE__, __LINE__)
@@ -0,0 +1,76 @@
+#include <cmath>
+#include <sstream>
+
+#include "TestCheck.h"
+#include "../OpenGL_Particles/systems/VectorField.h"
+
+using namespace particle_simulation;
+
+namespace
+{
+    bool parse(const std::string& text, VectorFieldVolume& volume)
+    {
+        std::istringstream stream(text);
+        return parseVectorFieldFGA(stream, volume);
+    }
+
+    bool near(float a, float b)
+    {
+        return std::abs(a - b) < 1e-5f;
+    }
+
+    void testParsesSmallField()
+    {
+        // Commas, spaces and line breaks all separate values
+        VectorFieldVolume volume;
+        CHECK(parse("2,1,1,\n-1,-2,-3, 1,2,3,\n0.5,0,0,\n0,-0.25,1e-1,\n", volume));
+        CHECK(volume.isValid());
+        CHECK(volume.resolution.x == 2 && volume.resolution.y == 1 && volume.resolution.z == 1);
+        CHECK(near(volume.boundsMin.y, -2.0f) && near(volume.boundsMax.z, 3.0f));
+        CHECK(volume.vectors.size() == 2);
+        CHECK(near(volume.vectors[0].x, 0.5f));
+        CHECK(near(volume.vectors[1].y, -0.25f) && near(volume.vectors[1].z, 0.1f));
+
+        // The bounds map onto the [0, 1] texture cube
+        const glm::mat4 localToVolume = vectorFieldLocalToVolume(volume);
+        const glm::vec4 low = localToVolume * glm::vec4(volume.boundsMin, 1.0f);
+        const glm::vec4 high = localToVolume * glm::vec4(volume.boundsMax, 1.0f);
+        CHECK(near(low.x, 0.0f) && near(low.y, 0.0f) && near(low.z, 0.0f));
+        CHECK(near(high.x, 1.0f) && near(high.y, 1.0f) && near(high.z, 1.0f));
+    }
+
+    void testRejectsTruncatedField()
+    {
+        VectorFieldVolume volume;
+        volume.resolution = glm::ivec3(7);
+
+        CHECK(!parse("2,2,2, -1,-1,-1, 1,1,1, 0,0,0, 1,1,1, 2,2,2", volume));
+        CHECK(!parse("2,1,1, -1,-1,-1, 1,1", volume));
+        CHECK(!parse("2,1", volume));
+
+        // A failed parse leaves the volume alone
+        CHECK(volume.resolution.x == 7 && volume.vectors.empty());
+    }
+
+    void testRejectsBadHeaders()
+    {
+        VectorFieldVolume volume;
+
+        // Would be 12 TB of vectors; must fail without trying to allocate them
+        CHECK(!parse("100000,100000,100000, -1,-1,-1, 1,1,1, 0,0,0", volume));
+        CHECK(!parse("1025,1,1, -1,-1,-1, 1,1,1, 0,0,0", volume));
+        CHECK(!parse("0,1,1, -1,-1,-1, 1,1,1", volume));
+        CHECK(!parse("-4,1,1, -1,-1,-1, 1,1,1, 0,0,0", volume));
+
+        // Empty bounds
+        CHECK(!parse("1,1,1, 1,-1,-1, 1,1,1, 0,0,0", volume));
+    }
+}
+
+int main()
+{
+    testParsesSmallField();
+    testRejectsTruncatedField();
+    testRejectsBadHeaders();
+    return test::finish("VectorFieldTests");
+}